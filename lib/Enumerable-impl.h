@@ -76,17 +76,1649 @@ inline constexpr bool is_default_lessable_v = ComparerTraits<T>::IsDefaultLessab
 
 template<class T>
 inline constexpr bool is_default_equalable_v = ComparerTraits<T>::IsDefaultEqualable;
+
+template<class T>
+inline constexpr bool is_enumerable_v = false;
+
+template<class T>
+inline constexpr bool is_enumerable_v<Enumerable<T>> = true;
+
+inline constexpr std::size_t kUnbounded = std::numeric_limits<std::size_t>::max();
+
+// The memory an operator buffers, charged to the MemoryContext that was current when the operator started. Update is called with the
+// operator's estimated total; the charge grows in steps of an eighth so that calling it for every element stays cheap.
+class MemoryCharge {
+public:
+    constexpr MemoryCharge() noexcept = default;
+
+    explicit MemoryCharge(const char* name) noexcept : MemoryCharge{MemoryContext::Current(), name} {
+    }
+
+    MemoryCharge(MemoryContext* context, const char* name) noexcept : context_{context}, name_{name} {
+    }
+
+    MemoryCharge(const MemoryCharge& rhs) = delete;
+    MemoryCharge& operator=(const MemoryCharge& rhs) = delete;
+
+    MemoryCharge(MemoryCharge&& rhs) noexcept
+        : context_{std::exchange(rhs.context_, nullptr)}, name_{rhs.name_}, charged_{std::exchange(rhs.charged_, 0)} {
+    }
+
+    MemoryCharge& operator=(MemoryCharge&& rhs) noexcept {
+        std::swap(context_, rhs.context_);
+        std::swap(name_, rhs.name_);
+        std::swap(charged_, rhs.charged_);
+        return *this;
+    }
+
+    ~MemoryCharge() {
+        Release();
+    }
+
+    explicit operator bool() const noexcept {
+        return context_ != nullptr;
+    }
+
+    void Update(std::size_t bytes) {
+        if (!context_ || (bytes <= charged_)) {
+            return;
+        }
+        auto step = std::min(charged_ / 8, context_->Available());
+        auto target = std::max(bytes, charged_ + step);
+        context_->Allocate(name_, target - charged_);
+        charged_ = target;
+    }
+
+    // Returns everything charged so far, for when the operator frees its buffers before it ends.
+    void Release() noexcept {
+        if (context_ && charged_) {
+            context_->Release(name_, std::exchange(charged_, 0));
+        }
+    }
+
+private:
+    MemoryContext* context_{};
+    const char* name_{""};
+    std::size_t charged_{};
+}; // class MemoryCharge
+
+// Shrinks the budget of a spilling operator to what the current MemoryContext has left, so it spills instead of failing.
+inline std::size_t GovernedBudget(std::size_t memoryBudget) {
+    if (auto context = MemoryContext::Current()) {
+        return std::min(memoryBudget, context->Available());
+    }
+    return memoryBudget;
+}
+
+// Identifies the order produced by OrderBy(keySelector, comparer). Only stateless callables can be told apart by their type, so any other
+// key selector or comparer yields no tag.
+template<class TKeySelector, class TComparer>
+const std::type_info* OrderTag() {
+    if constexpr (std::is_empty_v<TKeySelector> && std::is_empty_v<TComparer>) {
+        return &typeid(std::pair<TKeySelector, TComparer>);
+    } else {
+        return nullptr;
+    }
+}
+
+inline bool IsSameOrder(const std::type_info* lhs, const std::type_info* rhs) {
+    return lhs && rhs && (*lhs == *rhs);
+}
+
+// Identifies the order of the elements of a container the same way OrderTag does for OrderBy(). Only sets are known to be sorted.
+template<class TContainer>
+const std::type_info* ContainerOrderTag(const TContainer&) {
+    return nullptr;
+}
+
+template<class TKey, class TCompare, class TAllocator>
+const std::type_info* ContainerOrderTag(const std::set<TKey, TCompare, TAllocator>&) {
+    return OrderTag<std::identity, TCompare>();
+}
+
+template<class TKey, class TCompare, class TAllocator>
+const std::type_info* ContainerOrderTag(const std::multiset<TKey, TCompare, TAllocator>&) {
+    return OrderTag<std::identity, TCompare>();
+}
+
+// Natural merge sort: splits [first, last) into maximal non-descending runs (strictly descending runs are reversed in place, which keeps
+// equal elements in order) and merges neighbouring runs pairwise, O(n log runs) in total. Gives up as soon as the runs turn out to be too
+// short on average to beat a plain sort, leaving [first, last) a permutation of its input.
+template<class TIterator, class TLess>
+bool MergeRuns(TIterator first, TIterator last, TLess less) {
+    constexpr std::size_t kMinAverageRun = 32;
+
+    auto maxRuns = std::max<std::size_t>(std::distance(first, last) / kMinAverageRun, 1);
+    std::vector<TIterator> bounds{first};
+    for (auto i = first; i != last; i = bounds.back()) {
+        if (std::size(bounds) > maxRuns) {
+            return false;
+        }
+        auto j = std::next(i);
+        if ((j != last) && less(*j, *i)) {
+            for (++j; (j != last) && less(*j, *std::prev(j)); ++j) {
+            }
+            std::reverse(i, j);
+        } else {
+            for (; (j != last) && !less(*j, *std::prev(j)); ++j) {
+            }
+        }
+        bounds.push_back(j);
+    }
+
+    while (std::size(bounds) > 2) {
+        std::vector<TIterator> merged{first};
+        for (std::size_t i = 0; i + 2 < std::size(bounds); i += 2) {
+            std::inplace_merge(bounds[i], bounds[i + 1], bounds[i + 2], less);
+            merged.push_back(bounds[i + 2]);
+        }
+        if ((std::size(bounds) % 2) == 0) {
+            merged.push_back(bounds.back());
+        }
+        bounds = std::move(merged);
+    }
+    return true;
+}
+
+template<class T>
+class Ordering : public std::enable_shared_from_this<Ordering<T>> {
+public:
+    using iterator = typename Enumerable<T>::iterator;
+    using Container = typename Enumerable<T>::Container;
+
+    virtual ~Ordering() = default;
+
+    //! Returns the elements of [begin, end) whose stably sorted position lies in [skip, skip + take).
+    virtual Container Sort(iterator begin, iterator end, std::size_t skip, std::size_t take) const = 0;
+
+    //! Returns the element of [begin, end) at the stably sorted position index, if any.
+    virtual std::optional<T> ElementAt(iterator begin, iterator end, std::size_t index) const = 0;
+
+    //! Yields the elements of [begin, end) from the stably sorted position skip onwards, partitioning only as far as the consumer reads.
+    virtual Enumerable<T> SortIncrementally(iterator begin, iterator end, std::size_t skip) const = 0;
+}; // class Ordering
+
+template<class T, class TKeySelector, class TComparer>
+class KeyOrdering : public Ordering<T> {
+public:
+    using typename Ordering<T>::iterator;
+    using typename Ordering<T>::Container;
+
+    KeyOrdering(TKeySelector keySelector, TComparer comparer)
+        : keySelector_{std::move(keySelector)}, comparer_{std::move(comparer)}, context_{MemoryContext::Current()} {
+    }
+
+    Container Sort(iterator begin, iterator end, std::size_t skip, std::size_t take) const override {
+        if (take == 0) {
+            return {};
+        }
+        if ((take != kUnbounded) && (skip <= kUnbounded - take)) {
+            return SelectTop(begin, end, skip, skip + take);
+        }
+        auto less = [this] (const T& lhs, const T& rhs) { return Less(lhs, rhs); };
+        MemoryCharge charge{context_, "OrderBy"};
+        Container values{};
+        for (; begin != end; ++begin) {
+            values.push_back(*begin);
+            charge.Update(values.capacity() * sizeof(T));
+        }
+        if (!MergeRuns(std::begin(values), std::end(values), less)) {
+            std::stable_sort(std::begin(values), std::end(values), less);
+        }
+        values.erase(std::begin(values), std::begin(values) + std::min(skip, std::size(values)));
+        return values;
+    }
+
+    std::optional<T> ElementAt(iterator begin, iterator end, std::size_t index) const override {
+        MemoryCharge charge{context_, "OrderBy"};
+        std::vector<std::pair<std::size_t, T>> values{};
+        for (std::size_t i = 0; begin != end; ++begin, ++i) {
+            values.emplace_back(i, *begin);
+            charge.Update(values.capacity() * sizeof(values.front()));
+        }
+        if (index >= std::size(values)) {
+            return std::nullopt;
+        }
+        auto nth = std::begin(values) + index;
+        std::nth_element(std::begin(values), nth, std::end(values), [this] (auto&& lhs, auto&& rhs) { return StableLess(lhs, rhs); });
+        return std::move(nth->second);
+    }
+
+    // Incremental quicksort: pivots holds the final positions of the pivots still above the read position,
+    // so every element below the topmost pivot can be yielded as soon as its range is partitioned down to it.
+    Enumerable<T> SortIncrementally(iterator begin, iterator end, std::size_t skip) const override {
+        constexpr std::size_t kSortThreshold = 16;
+
+        auto self = this->shared_from_this();
+        auto less = [this] (auto&& lhs, auto&& rhs) { return StableLess(lhs, rhs); };
+        MemoryCharge charge{context_, "OrderBy"};
+        std::vector<std::pair<std::size_t, T>> values{};
+        for (std::size_t i = 0; begin != end; ++begin, ++i) {
+            values.emplace_back(i, *begin);
+            charge.Update(values.capacity() * sizeof(values.front()));
+        }
+        if (skip >= std::size(values)) {
+            co_return;
+        }
+        if (MergeRuns(std::begin(values), std::end(values), less)) {
+            for (auto i = skip; i < std::size(values); ++i) {
+                co_yield values[i].second;
+            }
+            co_return;
+        }
+        if (skip > 0) {
+            std::nth_element(std::begin(values), std::begin(values) + skip, std::end(values), less);
+        }
+
+        std::vector<std::size_t> pivots{std::size(values)};
+        for (auto i = skip; i < std::size(values);) {
+            auto bound = pivots.back();
+            if (i == bound) {
+                pivots.pop_back();
+                co_yield values[i].second;
+                ++i;
+            } else if (bound - i <= kSortThreshold) {
+                std::sort(std::begin(values) + i, std::begin(values) + bound, less);
+                for (; i < bound; ++i) {
+                    co_yield values[i].second;
+                }
+            } else {
+                auto first = std::begin(values) + i, last = std::begin(values) + bound - 1, middle = first + (last - first) / 2;
+                if (less(*middle, *first)) {
+                    std::iter_swap(middle, first);
+                }
+                if (less(*last, *middle)) {
+                    std::iter_swap(last, middle);
+                    if (less(*middle, *first)) {
+                        std::iter_swap(middle, first);
+                    }
+                }
+                std::iter_swap(middle, last);
+                auto split = std::partition(first, last, [&] (auto&& value) { return less(value, *last); });
+                std::iter_swap(split, last);
+                pivots.push_back(split - std::begin(values));
+            }
+        }
+    }
+
+private:
+    bool Less(const T& lhs, const T& rhs) const {
+        return comparer_(keySelector_(lhs), keySelector_(rhs));
+    }
+
+    bool StableLess(const std::pair<std::size_t, T>& lhs, const std::pair<std::size_t, T>& rhs) const {
+        if (Less(lhs.second, rhs.second)) {
+            return true;
+        }
+        return !Less(rhs.second, lhs.second) && (lhs.first < rhs.first);
+    }
+
+    // Keeps the count smallest elements in a bounded max-heap, so memory stays O(count) however long the input is.
+    Container SelectTop(iterator begin, iterator end, std::size_t skip, std::size_t count) const {
+        auto less = [this] (auto&& lhs, auto&& rhs) { return StableLess(lhs, rhs); };
+        MemoryCharge charge{context_, "OrderBy"};
+        std::vector<std::pair<std::size_t, T>> heap{};
+        for (std::size_t i = 0; begin != end; ++begin, ++i) {
+            auto&& source = *begin;
+            if (std::size(heap) < count) {
+                heap.emplace_back(i, source);
+                charge.Update(heap.capacity() * sizeof(heap.front()));
+                std::push_heap(std::begin(heap), std::end(heap), less);
+            } else if (Less(source, heap.front().second)) {
+                std::pop_heap(std::begin(heap), std::end(heap), less);
+                heap.back() = {i, source};
+                std::push_heap(std::begin(heap), std::end(heap), less);
+            }
+        }
+        std::sort_heap(std::begin(heap), std::end(heap), less);
+        Container values{};
+        for (auto i = std::begin(heap) + std::min(skip, std::size(heap)); i != std::end(heap); ++i) {
+            values.push_back(std::move(i->second));
+        }
+        return values;
+    }
+
+    mutable TKeySelector keySelector_;
+    mutable TComparer comparer_;
+    MemoryContext* context_;
+}; // class KeyOrdering
+
+inline void WriteBytes(std::FILE* file, const void* data, std::size_t size) {
+    // Empty vectors may pass a null pointer, which fwrite doesn't accept even for zero bytes.
+    if ((size != 0) && (std::fwrite(data, 1, size, file) != size)) {
+        throw std::runtime_error{"cpplinq: failed to write to a file"};
+    }
+}
+
+inline bool ReadBytes(std::FILE* file, void* data, std::size_t size) {
+    return (size == 0) || (std::fread(data, 1, size, file) == size);
+}
+
+// The number of bytes between the position of file and its end, or nothing if the file can't seek (e.g. a pipe).
+inline std::optional<std::uint64_t> RemainingBytes(std::FILE* file) {
+    auto position = std::ftell(file);
+    if ((position < 0) || (std::fseek(file, 0, SEEK_END) != 0)) {
+        return std::nullopt;
+    }
+    auto end = std::ftell(file);
+    if ((std::fseek(file, position, SEEK_SET) != 0) || (end < position)) {
+        return std::nullopt;
+    }
+    return static_cast<std::uint64_t>(end - position);
+}
+
+// Reads count values into values. The count comes from the file, so the vector grows as values are actually read rather than being
+// allocated up front, and a corrupt count runs into the end of the file instead of allocating whatever it says.
+template<class T>
+bool ReadArray(std::FILE* file, std::vector<T>& values, std::uint64_t count) {
+    constexpr std::uint64_t kChunk = 65536;
+    values.clear();
+    while (std::size(values) < count) {
+        auto offset = std::size(values);
+        auto chunk = static_cast<std::size_t>(std::min(count - offset, kChunk));
+        values.resize(offset + chunk);
+        if (!ReadBytes(file, std::data(values) + offset, chunk * sizeof(T))) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// An anonymous file that is deleted when it is closed.
+class TemporaryFile {
+public:
+    TemporaryFile() : file_{std::tmpfile()} {
+        if (!file_) {
+            throw std::runtime_error{"cpplinq: failed to create a temporary file"};
+        }
+    }
+
+    TemporaryFile(const TemporaryFile& rhs) = delete;
+    TemporaryFile& operator=(const TemporaryFile& rhs) = delete;
+
+    TemporaryFile(TemporaryFile&& rhs) noexcept : file_{std::exchange(rhs.file_, nullptr)} {
+    }
+
+    TemporaryFile& operator=(TemporaryFile&& rhs) noexcept {
+        std::swap(file_, rhs.file_);
+        return *this;
+    }
+
+    ~TemporaryFile() {
+        if (file_) {
+            std::fclose(file_);
+        }
+    }
+
+    std::FILE* Get() const noexcept {
+        return file_;
+    }
+
+    void Rewind() const {
+        std::rewind(file_);
+    }
+
+private:
+    std::FILE* file_{};
+}; // class TemporaryFile
+
+template<class TSerializer, class TIterator>
+TemporaryFile SpillRun(TIterator begin, TIterator end) {
+    TemporaryFile file{};
+    for (; begin != end; ++begin) {
+        TSerializer::Write(file.Get(), *begin);
+    }
+    return file;
+}
+
+template<class T, class TSerializer>
+Enumerable<T> ReadSpilled(TemporaryFile file) {
+    file.Rewind();
+    while (auto value = TSerializer::Read(file.Get())) {
+        co_yield std::move(*value);
+    }
+}
+
+// Reorders rows so that the rows of every group are contiguous and keep their order, by a counting sort in place: groups[i] is the
+// group of rows[i], below count. Returns the offsets of the groups, i.e. group g is rows [offsets[g], offsets[g + 1]).
+template<class TElement>
+std::vector<std::size_t> GroupContiguously(std::vector<TElement>& rows, std::vector<std::size_t> groups, std::size_t count) {
+    std::vector<std::size_t> offsets(count + 1);
+    for (auto group : groups) {
+        ++offsets[group + 1];
+    }
+    std::partial_sum(std::begin(offsets), std::end(offsets), std::begin(offsets));
+    auto next = offsets;
+    for (auto&& group : groups) {
+        group = next[group]++;
+    }
+    // groups now holds where each row goes; every swap puts one row in its place.
+    for (std::size_t i = 0; i < std::size(rows); ++i) {
+        while (groups[i] != i) {
+            auto j = groups[i];
+            std::swap(rows[i], rows[j]);
+            std::swap(groups[i], groups[j]);
+        }
+    }
+    return offsets;
+}
+
+inline constexpr std::size_t kSpillPartitions = 16;
+
+// Spreads the bits of a hash over all 64 bits (the splitmix64 finalizer). Hashes such as std::hash<int> are often the identity, so they
+// are mixed before their bits pick a partition, a block or a bucket.
+inline std::uint64_t MixHash(std::uint64_t x) noexcept {
+    x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ull;
+    x = (x ^ (x >> 27)) * 0x94d049bb133111ebull;
+    return x ^ (x >> 31);
+}
+
+// Hashes bytes in the style of wyhash: eight bytes at a time, each pair of words folded with one 64 x 64 -> 128-bit multiplication.
+// Keys up to 16 bytes take a single multiplication; longer ones run three independent lanes of 48 bytes.
+inline std::uint64_t FoldedMultiply(std::uint64_t a, std::uint64_t b) noexcept {
+#ifdef __SIZEOF_INT128__
+    auto product = static_cast<unsigned __int128>(a) * b;
+    return static_cast<std::uint64_t>(product) ^ static_cast<std::uint64_t>(product >> 64);
+#else
+    auto lo = (a & 0xffffffffull) * (b & 0xffffffffull);
+    auto mid1 = (a >> 32) * (b & 0xffffffffull);
+    auto mid2 = (a & 0xffffffffull) * (b >> 32);
+    auto hi = (a >> 32) * (b >> 32);
+    auto carry = ((lo >> 32) + (mid1 & 0xffffffffull) + (mid2 & 0xffffffffull)) >> 32;
+    return (lo + (mid1 << 32) + (mid2 << 32)) ^ (hi + (mid1 >> 32) + (mid2 >> 32) + carry);
+#endif
+}
+
+inline std::uint64_t HashBytes(const void* data, std::size_t size) noexcept {
+    constexpr std::uint64_t kSecret0 = 0xa0761d6478bd642full;
+    constexpr std::uint64_t kSecret1 = 0xe7037ed1a0b428dbull;
+    constexpr std::uint64_t kSecret2 = 0x8ebc6af09c88c6e3ull;
+    constexpr std::uint64_t kSecret3 = 0x589965cc75374cc3ull;
+    auto read8 = [] (const unsigned char* p) {
+        std::uint64_t x{};
+        std::memcpy(&x, p, sizeof(x));
+        return x;
+    };
+    auto read4 = [] (const unsigned char* p) {
+        std::uint32_t x{};
+        std::memcpy(&x, p, sizeof(x));
+        return std::uint64_t{x};
+    };
+
+    auto p = static_cast<const unsigned char*>(data);
+    auto seed = FoldedMultiply(kSecret0, kSecret1);
+    std::uint64_t a{};
+    std::uint64_t b{};
+    if (size <= 16) {
+        if (size >= 4) {
+            auto offset = (size >> 3) << 2;
+            a = (read4(p) << 32) | read4(p + offset);
+            b = (read4(p + size - 4) << 32) | read4(p + size - 4 - offset);
+        } else if (size > 0) {
+            a = (std::uint64_t{p[0]} << 16) | (std::uint64_t{p[size >> 1]} << 8) | p[size - 1];
+        }
+    } else {
+        auto remaining = size;
+        if (remaining > 48) {
+            auto lane1 = seed;
+            auto lane2 = seed;
+            do {
+                seed = FoldedMultiply(read8(p) ^ kSecret1, read8(p + 8) ^ seed);
+                lane1 = FoldedMultiply(read8(p + 16) ^ kSecret2, read8(p + 24) ^ lane1);
+                lane2 = FoldedMultiply(read8(p + 32) ^ kSecret3, read8(p + 40) ^ lane2);
+                p += 48;
+                remaining -= 48;
+            } while (remaining > 48);
+            seed ^= lane1 ^ lane2;
+        }
+        while (remaining > 16) {
+            seed = FoldedMultiply(read8(p) ^ kSecret1, read8(p + 8) ^ seed);
+            p += 16;
+            remaining -= 16;
+        }
+        // The last 16 bytes, overlapping bytes already hashed if fewer are left.
+        a = read8(p + remaining - 16);
+        b = read8(p + remaining - 8);
+    }
+    return FoldedMultiply(kSecret1 ^ size, FoldedMultiply(a ^ kSecret1, b ^ seed));
+}
+
+// Picks the spill partition of a hash. Every recursion depth mixes the hash differently, so keys that shared a partition at one depth
+// are spread out at the next.
+inline std::size_t SpillPartition(std::size_t hash, std::size_t depth) {
+    return static_cast<std::size_t>(MixHash(static_cast<std::uint64_t>(hash) + (depth + 1) * 0x9e3779b97f4a7c15ull) % kSpillPartitions);
+}
+
+// Deepest recursion at which a spilling operator still partitions. Past it, whatever is left can't be split by hashing (e.g. a single key
+// with too many elements) and is processed in memory, over the budget and charged to the MemoryContext, see MemoryContext.
+inline constexpr std::size_t kMaxSpillDepth = 4;
+
+template<class T, class TEnumerable>
+Enumerable<T> Stream(const TEnumerable& enumerable) {
+    for (auto&& element : enumerable) {
+        co_yield element;
+    }
+}
+
+// The build side of a hybrid hash join: values are kept in kSpillPartitions hash partitions, and whenever the budget is exceeded the
+// largest partition still in memory is written to a temporary file. Values of a spilled partition go straight to its file from then on.
+template<class TKey, class TValue, class THash, class TSerializer>
+class SpillingMultimap {
+public:
+    using Map = std::unordered_multimap<TKey, TValue, THash>;
+
+    SpillingMultimap(std::size_t memoryBudget, std::size_t depth, const char* name)
+        : memoryBudget_{memoryBudget}, depth_{depth}, partitions_(kSpillPartitions), charge_{name} {
+    }
+
+    std::size_t PartitionOf(const TKey& key) const {
+        return SpillPartition(hash_(key), depth_);
+    }
+
+    bool IsSpilled(std::size_t partition) const {
+        return partitions_[partition].file.has_value();
+    }
+
+    void Insert(TKey key, const TValue& value) {
+        auto& partition = partitions_[PartitionOf(key)];
+        if (partition.file) {
+            TSerializer::Write(partition.file->Get(), value);
+            return;
+        }
+        partition.values.emplace(std::move(key), value);
+        usage_ += sizeof(TKey) + sizeof(TValue);
+        while ((usage_ > memoryBudget_) && (depth_ < kMaxSpillDepth)) {
+            SpillLargest();
+        }
+        charge_.Update(usage_);
+    }
+
+    auto EqualRange(const TKey& key) const {
+        return partitions_[PartitionOf(key)].values.equal_range(key);
+    }
+
+    //! Frees the partitions held in memory and hands over the files of the spilled ones.
+    std::vector<std::optional<TemporaryFile>> Release() {
+        std::vector<std::optional<TemporaryFile>> files{};
+        for (auto&& partition : partitions_) {
+            files.push_back(std::move(partition.file));
+        }
+        partitions_.clear();
+        usage_ = 0;
+        charge_.Release();
+        return files;
+    }
+
+private:
+    struct Partition {
+        Map values{};
+        std::optional<TemporaryFile> file{};
+    }; // struct Partition
+
+    void SpillLargest() {
+        auto& largest = *std::max_element(std::begin(partitions_), std::end(partitions_), [] (auto&& lhs, auto&& rhs) {
+            return std::size(lhs.values) < std::size(rhs.values);
+        });
+        largest.file.emplace();
+        for (auto&& [key, value] : largest.values) {
+            TSerializer::Write(largest.file->Get(), value);
+        }
+        usage_ -= std::size(largest.values) * (sizeof(TKey) + sizeof(TValue));
+        Map{}.swap(largest.values);
+    }
+
+    std::size_t memoryBudget_;
+    std::size_t depth_;
+    std::size_t usage_{};
+    THash hash_{};
+    std::vector<Partition> partitions_;
+    MemoryCharge charge_;
+}; // class SpillingMultimap
+
+// The inner side of a merge join: walks a sequence sorted by key and hands out the run of elements that share a key. Keys must be looked
+// up in ascending order, and only the current run is held in memory, so consecutive lookups of the same key reuse it.
+template<class TInner, class TKeySelector, class TLess>
+class SortedRuns {
+public:
+    SortedRuns(Enumerable<TInner> inner, TKeySelector keySelector, const char* name)
+        : current_{std::move(inner).begin()}, keySelector_{std::move(keySelector)}, charge_{name} {
+    }
+
+    template<class TKey>
+    const std::vector<TInner>& Find(const TKey& key) {
+        typename Enumerable<TInner>::iterator end{};
+        if (!runKey_ || less_(*runKey_, key)) {
+            run_.clear();
+            runKey_.reset();
+            while ((current_ != end) && less_(keySelector_(*current_), key)) {
+                ++current_;
+            }
+            if ((current_ != end) && !less_(key, keySelector_(*current_))) {
+                runKey_.emplace(keySelector_(*current_));
+                for (; (current_ != end) && !less_(*runKey_, keySelector_(*current_)); ++current_) {
+                    run_.push_back(*current_);
+                    charge_.Update(run_.capacity() * sizeof(TInner));
+                }
+            }
+        }
+        if (runKey_ && !less_(key, *runKey_)) {
+            return run_;
+        }
+        return empty_;
+    }
+
+private:
+    typename Enumerable<TInner>::iterator current_;
+    TKeySelector keySelector_;
+    TLess less_{};
+    std::optional<std::invoke_result_t<TKeySelector, const TInner&>> runKey_{};
+    std::vector<TInner> run_{};
+    std::vector<TInner> empty_{};
+    MemoryCharge charge_;
+}; // class SortedRuns
+
+// A tournament tree over k players that keeps the loser of every match in the inner nodes. beats(lhs, rhs) must be a strict order on
+// the players; when the winner's value changes, replaying the matches on its path to the root finds the next winner with about log2(k)
+// comparisons, half as many as a binary heap needs.
+template<class TBeats>
+class LoserTree {
+public:
+    LoserTree(std::size_t size, TBeats beats) : size_{size}, nodes_(std::max<std::size_t>(size, 1)), beats_{std::move(beats)} {
+        std::vector<std::size_t> winners(2 * size);
+        for (std::size_t i = 0; i < size; ++i) {
+            winners[size + i] = i;
+        }
+        for (auto node = size - 1; node > 0; --node) {
+            auto winner = winners[2 * node];
+            auto loser = winners[2 * node + 1];
+            if (beats_(loser, winner)) {
+                std::swap(winner, loser);
+            }
+            winners[node] = winner;
+            nodes_[node] = loser;
+        }
+        nodes_[0] = (size > 1) ? winners[1] : 0;
+    }
+
+    std::size_t Winner() const noexcept {
+        return nodes_[0];
+    }
+
+    // Replays the matches of the winner after its value changed.
+    void Replay() {
+        auto winner = nodes_[0];
+        for (auto node = (size_ + winner) / 2; node > 0; node /= 2) {
+            if (beats_(nodes_[node], winner)) {
+                std::swap(nodes_[node], winner);
+            }
+        }
+        nodes_[0] = winner;
+    }
+
+private:
+    std::size_t size_;
+    std::vector<std::size_t> nodes_;
+    TBeats beats_;
+}; // class LoserTree
+
+// A split block Bloom filter: every key sets one bit in each of the eight words of a single 64-byte block, so a lookup touches one cache
+// line and tests the eight words independently, which compilers turn into a few vector instructions. With 16 bits per key about one
+// lookup in 1000 of a key that was never inserted answers true.
+class BloomFilter {
+public:
+    explicit BloomFilter(std::size_t count) : blocks_(std::bit_ceil(std::max<std::size_t>(count * kBitsPerKey / kBlockBits, 1))) {
+    }
+
+    void Insert(std::size_t hash) noexcept {
+        auto&& block = blocks_[BlockIndex(hash)];
+        auto key = static_cast<std::uint32_t>(MixHash(hash));
+        for (std::size_t i = 0; i < kWords; ++i) {
+            block.words[i] |= Bit(key, i);
+        }
+    }
+
+    bool MayContain(std::size_t hash) const noexcept {
+        auto&& block = blocks_[BlockIndex(hash)];
+        auto key = static_cast<std::uint32_t>(MixHash(hash));
+        std::uint64_t missing = 0;
+        for (std::size_t i = 0; i < kWords; ++i) {
+            missing |= Bit(key, i) & ~block.words[i];
+        }
+        return missing == 0;
+    }
+
+    std::size_t Bytes() const noexcept {
+        return std::size(blocks_) * sizeof(Block);
+    }
+
+private:
+    static constexpr std::size_t kWords = 8;
+    static constexpr std::size_t kBlockBits = kWords * 64;
+    static constexpr std::size_t kBitsPerKey = 16;
+
+    struct alignas(64) Block {
+        std::array<std::uint64_t, kWords> words{};
+    }; // struct Block
+
+    // Picks a bit of word i from the low half of the mixed hash with an odd multiplier per word.
+    static std::uint64_t Bit(std::uint32_t key, std::size_t i) noexcept {
+        constexpr std::array<std::uint32_t, kWords> kSalts{
+            0x47b6137bu, 0x44974d91u, 0x8824ad5bu, 0xa2b7289du, 0x705495c7u, 0x2df1424bu, 0x9efc4947u, 0x5c6bfb31u};
+        return std::uint64_t{1} << ((key * kSalts[i]) >> 26);
+    }
+
+    std::size_t BlockIndex(std::size_t hash) const noexcept {
+        return static_cast<std::size_t>(MixHash(hash) >> 32) & (std::size(blocks_) - 1);
+    }
+
+    std::vector<Block> blocks_;
+}; // class BloomFilter
+
+// Hash tables with fewer keys than this are probed directly: they fit in cache, so a filter in front of them saves nothing.
+inline constexpr std::size_t kBloomFilterMinKeys = 65536;
+
+// A minimal perfect hash function in the style of PTHash: it maps n distinct hashes to the positions 0 to n - 1 without collisions. Hashes
+// are split into buckets of about four; every bucket stores a pilot, chosen when building so that its hashes, mixed with the pilot, land
+// on free positions of a table slightly larger than n. The few positions past n are remapped to the free ones below it. A lookup reads
+// one pilot and computes the position; there are no collision chains to follow.
+class PerfectHash {
+public:
+    // Builds over hashes, which must all be different; returns nothing if two are equal.
+    static std::optional<PerfectHash> Build(const std::vector<std::uint64_t>& hashes) {
+        auto sorted = hashes;
+        std::sort(std::begin(sorted), std::end(sorted));
+        if (std::adjacent_find(std::begin(sorted), std::end(sorted)) != std::end(sorted)) {
+            return std::nullopt;
+        }
+        // A bucket that finds no pilot is very unlikely; another seed starts over with different buckets.
+        for (std::uint64_t seed = 0;; ++seed) {
+            PerfectHash result{seed, std::size(hashes)};
+            if (result.Place(hashes)) {
+                return result;
+            }
+        }
+    }
+
+    std::size_t Position(std::size_t hash) const noexcept {
+        auto x = MixHash(static_cast<std::uint64_t>(hash) ^ seed_);
+        auto position = static_cast<std::size_t>((x ^ MixHash(pilots_[Bucket(x)])) % tableSize_);
+        return (position < size_) ? position : remap_[position - size_];
+    }
+
+    std::size_t Size() const noexcept {
+        return size_;
+    }
+
+    std::size_t Bytes() const noexcept {
+        return (std::size(pilots_) + std::size(remap_)) * sizeof(std::uint32_t);
+    }
+
+    void Write(std::FILE* file) const {
+        std::array<std::uint64_t, 4> header{seed_, size_, tableSize_, std::size(pilots_)};
+        WriteBytes(file, std::data(header), sizeof(header));
+        WriteBytes(file, std::data(pilots_), std::size(pilots_) * sizeof(std::uint32_t));
+        WriteBytes(file, std::data(remap_), std::size(remap_) * sizeof(std::uint32_t));
+    }
+
+    // Reads a PerfectHash written by Write; returns nothing if the file doesn't hold a valid one.
+    static std::optional<PerfectHash> Read(std::FILE* file) {
+        std::array<std::uint64_t, 4> header{};
+        if (!ReadBytes(file, std::data(header), sizeof(header))) {
+            return std::nullopt;
+        }
+        auto [seed, size, tableSize, pilotCount] = header;
+        // Positions are stored in 32 bits, and the table size and the number of pilots follow from the number of hashes, so a header
+        // that disagrees with them wasn't written by Write.
+        if ((size > std::numeric_limits<std::uint32_t>::max()) || (tableSize != TableSize(size)) || (pilotCount != PilotCount(size))) {
+            return std::nullopt;
+        }
+        if (auto remaining = RemainingBytes(file); remaining && (*remaining < (pilotCount + tableSize - size) * sizeof(std::uint32_t))) {
+            return std::nullopt;
+        }
+        PerfectHash result{seed, static_cast<std::size_t>(size), {}};
+        if (!ReadArray(file, result.pilots_, pilotCount) || !ReadArray(file, result.remap_, tableSize - size)) {
+            return std::nullopt;
+        }
+        auto valid = [&] (std::uint32_t position) {
+            return position < size;
+        };
+        if (!std::all_of(std::begin(result.pilots_), std::end(result.pilots_), [] (std::uint32_t pilot) { return pilot < kMaxPilot; })
+                || !std::all_of(std::begin(result.remap_), std::end(result.remap_), valid)) {
+            return std::nullopt;
+        }
+        return result;
+    }
+
+private:
+    static constexpr std::size_t kBucketSize = 4;
+    static constexpr std::uint32_t kMaxPilot = 1 << 20;
+
+    static std::uint64_t TableSize(std::uint64_t size) noexcept {
+        return size + size / 32 + 1;
+    }
+
+    static std::uint64_t PilotCount(std::uint64_t size) noexcept {
+        return std::max<std::uint64_t>((size + kBucketSize - 1) / kBucketSize, 1);
+    }
+
+    PerfectHash(std::uint64_t seed, std::size_t size)
+        : seed_{seed}, size_{size}, tableSize_{static_cast<std::size_t>(TableSize(size))}, pilots_(static_cast<std::size_t>(PilotCount(size))) {
+    }
+
+    // A PerfectHash whose pilots are yet to be read.
+    PerfectHash(std::uint64_t seed, std::size_t size, std::vector<std::uint32_t> pilots)
+        : seed_{seed}, size_{size}, tableSize_{static_cast<std::size_t>(TableSize(size))}, pilots_(std::move(pilots)) {
+    }
+
+    std::size_t Bucket(std::uint64_t x) const noexcept {
+        return static_cast<std::size_t>((x >> 32) % std::size(pilots_));
+    }
+
+    bool Place(const std::vector<std::uint64_t>& hashes) {
+        // Counting sort of the mixed hashes by bucket, then the buckets by size: large buckets are placed first, while most positions
+        // are still free.
+        std::vector<std::uint64_t> mixed(std::size(hashes));
+        std::vector<std::size_t> starts(std::size(pilots_) + 1);
+        for (std::size_t i = 0; i < std::size(hashes); ++i) {
+            mixed[i] = MixHash(hashes[i] ^ seed_);
+            ++starts[Bucket(mixed[i]) + 1];
+        }
+        std::partial_sum(std::begin(starts), std::end(starts), std::begin(starts));
+        std::vector<std::uint64_t> byBucket(std::size(hashes));
+        auto next = starts;
+        for (auto x : mixed) {
+            byBucket[next[Bucket(x)]++] = x;
+        }
+        std::vector<std::size_t> buckets(std::size(pilots_));
+        std::iota(std::begin(buckets), std::end(buckets), std::size_t{0});
+        std::stable_sort(std::begin(buckets), std::end(buckets), [&] (std::size_t lhs, std::size_t rhs) {
+            return (starts[lhs + 1] - starts[lhs]) > (starts[rhs + 1] - starts[rhs]);
+        });
+
+        std::vector<bool> taken(tableSize_);
+        std::vector<std::size_t> positions{};
+        for (auto bucket : buckets) {
+            auto first = std::begin(byBucket) + starts[bucket], last = std::begin(byBucket) + starts[bucket + 1];
+            if (first == last) {
+                break;
+            }
+            for (std::uint32_t pilot = 0;; ++pilot) {
+                if (pilot == kMaxPilot) {
+                    return false;
+                }
+                auto pilotHash = MixHash(pilot);
+                positions.clear();
+                for (auto x = first; x != last; ++x) {
+                    auto position = static_cast<std::size_t>((*x ^ pilotHash) % tableSize_);
+                    if (taken[position] || (std::find(std::begin(positions), std::end(positions), position) != std::end(positions))) {
+                        break;
+                    }
+                    positions.push_back(position);
+                }
+                if (std::size(positions) == static_cast<std::size_t>(last - first)) {
+                    for (auto position : positions) {
+                        taken[position] = true;
+                    }
+                    pilots_[bucket] = pilot;
+                    break;
+                }
+            }
+        }
+
+        remap_.assign(tableSize_ - size_, 0);
+        std::size_t free = 0;
+        for (auto position = size_; position < tableSize_; ++position) {
+            if (taken[position]) {
+                while (taken[free]) {
+                    ++free;
+                }
+                remap_[position - size_] = static_cast<std::uint32_t>(free++);
+            }
+        }
+        return true;
+    }
+
+    std::uint64_t seed_;
+    std::size_t size_;
+    std::size_t tableSize_;
+    std::vector<std::uint32_t> pilots_;
+    std::vector<std::uint32_t> remap_{};
+}; // class PerfectHash
+
+// Files written by Lookup::Write start with these bytes and the version of their format. Version 2 added the digest of the key hashes.
+inline constexpr std::array<char, 8> kLookupMagic{'c', 'p', 'p', 'l', 'i', 'n', 'q', 'L'};
+inline constexpr std::uint32_t kLookupFormatVersion = 2;
+
+// A filter over the keys of a hash table, or none if the table is small. The filter uses the table's own hash function.
+template<class THashTable>
+std::optional<BloomFilter> KeyFilter(const THashTable& table) {
+    if (std::size(table) < kBloomFilterMinKeys) {
+        return std::nullopt;
+    }
+    std::optional<BloomFilter> filter{std::in_place, std::size(table)};
+    auto hash = table.hash_function();
+    for (auto&& value : table) {
+        if constexpr (requires { typename THashTable::mapped_type; }) {
+            filter->Insert(hash(value.first));
+        } else {
+            filter->Insert(hash(value));
+        }
+    }
+    return filter;
+}
+
+// Hints the processor to load the cache line of address; a no-op where the compiler has no such hint.
+inline void Prefetch(const void* address) noexcept {
+#if defined(__GNUC__) || defined(__clang__)
+    __builtin_prefetch(address);
+#else
+    (void)address;
+#endif
+}
+
+// Indexes with at most this many distinct keys are searched linearly, which beats hashing while the keys fit in a few cache lines.
+inline constexpr std::size_t kLinearScanMaxKeys = 32;
+
+// Numbers distinct keys 0, 1, 2, ... in the order they are first inserted and keeps them contiguously, with their hashes next to them so
+// that no key is hashed twice. Up to kLinearScanMaxKeys keys are found by comparing hashes linearly; past that an open addressing table of
+// key numbers with linear probing is built on top, so there is no node per key and growing the table moves numbers, never keys.
+template<class TKey, class THash, class TEqual = std::equal_to<>>
+class KeyIndex {
+public:
+    // The number of key and whether it was inserted by this call.
+    std::pair<std::size_t, bool> Insert(TKey key) {
+        auto hash = hash_(key);
+        if (auto index = Find(key, hash)) {
+            return {*index, false};
+        }
+        auto index = std::size(keys_);
+        keys_.push_back(std::move(key));
+        hashes_.push_back(hash);
+        if (!slots_.empty() && (std::size(keys_) * 4 <= std::size(slots_) * 3)) {
+            Place(index);
+        } else if (std::size(keys_) > kLinearScanMaxKeys) {
+            Rehash(std::bit_ceil(std::size(keys_) * 2));
+        }
+        return {index, true};
+    }
+
+    template<class U>
+    std::optional<std::size_t> Find(const U& key) const {
+        return Find(key, hash_(key));
+    }
+
+    // Makes room for count keys, so that the table doesn't grow until more are inserted.
+    void Reserve(std::size_t count) {
+        keys_.reserve(count);
+        hashes_.reserve(count);
+        if ((count > kLinearScanMaxKeys) && (std::size(slots_) * 3 < count * 4)) {
+            Rehash(std::bit_ceil(count + count / 3 + 1));
+        }
+    }
+
+    template<class U>
+    std::size_t HashOf(const U& key) const {
+        return hash_(key);
+    }
+
+    // Prefetches the slot a lookup of hash starts at. A batch of lookups prefetches all its slots, then all its entries (which reads the
+    // slots), and only then compares keys, so that the cache misses of the batch overlap.
+    void PrefetchSlot(std::size_t hash) const noexcept {
+        if (!slots_.empty()) {
+            Prefetch(&slots_[Slot(hash)]);
+        }
+    }
+
+    // Prefetches the hash and the key in the slot a lookup of hash starts at.
+    void PrefetchEntry(std::size_t hash) const noexcept {
+        if (!slots_.empty()) {
+            if (auto index = slots_[Slot(hash)]; index != kEmpty) {
+                Prefetch(&hashes_[index]);
+                Prefetch(&keys_[index]);
+            }
+        }
+    }
+
+    // Finds key, whose hash is already known.
+    template<class U>
+    std::optional<std::size_t> Find(const U& key, std::size_t hash) const {
+        if (slots_.empty()) {
+            for (std::size_t index = 0; index < std::size(keys_); ++index) {
+                if ((hashes_[index] == hash) && equal_(keys_[index], key)) {
+                    return index;
+                }
+            }
+            return std::nullopt;
+        }
+        for (auto slot = Slot(hash);; slot = (slot + 1) & (std::size(slots_) - 1)) {
+            auto index = slots_[slot];
+            if (index == kEmpty) {
+                return std::nullopt;
+            }
+            if ((hashes_[index] == hash) && equal_(keys_[index], key)) {
+                return index;
+            }
+        }
+    }
+
+    std::size_t Size() const noexcept {
+        return std::size(keys_);
+    }
+
+    // The keys by number.
+    const std::vector<TKey>& Keys() const noexcept {
+        return keys_;
+    }
+
+    // The hashes of the keys by number.
+    const std::vector<std::size_t>& Hashes() const noexcept {
+        return hashes_;
+    }
+
+    std::size_t Bytes() const noexcept {
+        return keys_.capacity() * sizeof(TKey) + (hashes_.capacity() + slots_.capacity()) * sizeof(std::size_t);
+    }
+
+    // At most the bytes Reserve takes per key: the key, its hash and fewer than three slots.
+    static constexpr std::size_t kMaxBytesPerKey = sizeof(TKey) + 4 * sizeof(std::size_t);
+
+private:
+    static constexpr std::size_t kEmpty = std::numeric_limits<std::size_t>::max();
+
+    std::size_t Slot(std::size_t hash) const noexcept {
+        return static_cast<std::size_t>(MixHash(hash)) & (std::size(slots_) - 1);
+    }
+
+    void Place(std::size_t index) {
+        auto slot = Slot(hashes_[index]);
+        while (slots_[slot] != kEmpty) {
+            slot = (slot + 1) & (std::size(slots_) - 1);
+        }
+        slots_[slot] = index;
+    }
+
+    void Rehash(std::size_t count) {
+        slots_.assign(count, kEmpty);
+        for (std::size_t index = 0; index < std::size(keys_); ++index) {
+            Place(index);
+        }
+    }
+
+    THash hash_{};
+    TEqual equal_{};
+    std::vector<TKey> keys_{};
+    std::vector<std::size_t> hashes_{};
+    std::vector<std::size_t> slots_{};
+}; // class KeyIndex
+
+template<class TKey, class THash, class TEqual>
+std::optional<BloomFilter> KeyFilter(const KeyIndex<TKey, THash, TEqual>& index) {
+    if (index.Size() < kBloomFilterMinKeys) {
+        return std::nullopt;
+    }
+    std::optional<BloomFilter> filter{std::in_place, index.Size()};
+    for (auto hash : index.Hashes()) {
+        filter->Insert(hash);
+    }
+    return filter;
+}
+
+// Lookups in a hash table are batched this many at a time, see KeyIndex::PrefetchSlot.
+inline constexpr std::size_t kProbeBatchSize = 16;
+
+// The number of elements indexed before a Presizer estimates the number of distinct keys among all of them.
+inline constexpr std::size_t kCardinalitySampleSize = 4096;
+
+// Sizes a KeyIndex up front so that it doesn't grow a step at a time: to the expected number of keys if the caller knows it, or else, when
+// the number of elements is known, to an estimate made once the first kCardinalitySampleSize of them are indexed. The estimate is GEE
+// (Charikar et al.): each key seen once in the sample stands for sqrt(elements / sample) keys, and each key seen more often for itself.
+// The table already counts the distinct keys of the sample exactly, so instead of a sketch only the frequency of each is kept. elementCount
+// must be exact, not an upper bound, and no more is reserved than the current MemoryContext has left, so presizing never fails where
+// growing step by step would have fit.
+template<class TKeyIndex>
+class Presizer {
+public:
+    Presizer(TKeyIndex& index, std::optional<std::size_t> expectedCount, std::optional<std::size_t> elementCount) : index_{index} {
+        if (expectedCount) {
+            Reserve(*expectedCount);
+        } else if (elementCount && (*elementCount > kCardinalitySampleSize)) {
+            elementCount_ = *elementCount;
+            sampled_ = 0;
+        }
+    }
+
+    // Called with the number of the key of each element indexed.
+    void Indexed(std::size_t number) {
+        if (sampled_ == kCardinalitySampleSize) {
+            return;
+        }
+        if (number == std::size(frequencies_)) {
+            frequencies_.push_back(0);
+        }
+        ++frequencies_[number];
+        if (++sampled_ == kCardinalitySampleSize) {
+            auto distinct = std::size(frequencies_);
+            auto singletons = static_cast<std::size_t>(std::count(std::begin(frequencies_), std::end(frequencies_), 1u));
+            auto estimate = std::sqrt(static_cast<double>(elementCount_) / sampled_) * singletons + (distinct - singletons);
+            Reserve(std::min(static_cast<std::size_t>(estimate), elementCount_ - sampled_ + distinct));
+            frequencies_ = {};
+        }
+    }
+
+private:
+    void Reserve(std::size_t count) {
+        if (auto context = MemoryContext::Current()) {
+            count = std::min(count, index_.Size() + context->Available() / TKeyIndex::kMaxBytesPerKey);
+        }
+        index_.Reserve(count);
+    }
+
+    TKeyIndex& index_;
+    std::size_t elementCount_{};
+    std::size_t sampled_{kCardinalitySampleSize};
+    std::vector<std::uint32_t> frequencies_{};
+}; // class Presizer
+
+// A compressed bitmap of 64-bit values in the style of Roaring: values are split by their high 48 bits into chunks of 65536, and a chunk
+// holds the low 16 bits of its values in a sorted array while it has at most 4096 of them, and in a bitmap of 1024 words past that, so
+// that a chunk never takes more than 8 KiB. Chunks are kept in the order they are created and found through a KeyIndex of their high
+// bits, so a new chunk costs the same wherever its values fall. Set operations pair up the chunks of two bitmaps in ascending order and
+// combine bitmap chunks word by word, in loops that compilers vectorize.
+class Bitmap {
+public:
+    bool Insert(std::uint64_t value) {
+        auto high = value >> 16;
+        auto [index, inserted] = highs_.Insert(high);
+        if (inserted) {
+            chunks_.push_back(Chunk{high});
+        }
+        auto&& chunk = chunks_[index];
+        auto low = static_cast<std::uint16_t>(value);
+        if (!chunk.words.empty()) {
+            auto&& word = chunk.words[low >> 6];
+            auto bit = std::uint64_t{1} << (low & 63);
+            if (word & bit) {
+                return false;
+            }
+            word |= bit;
+        } else {
+            auto position = std::lower_bound(std::begin(chunk.array), std::end(chunk.array), low);
+            if ((position != std::end(chunk.array)) && (*position == low)) {
+                return false;
+            }
+            auto before = ChunkBytes(chunk);
+            chunk.array.insert(position, low);
+            if (std::size(chunk.array) > kMaxArraySize) {
+                ToWords(chunk);
+            }
+            chunkBytes_ = chunkBytes_ - before + ChunkBytes(chunk);
+        }
+        ++chunk.count;
+        ++size_;
+        return true;
+    }
+
+    bool Contains(std::uint64_t value) const {
+        auto index = highs_.Find(value >> 16);
+        if (!index) {
+            return false;
+        }
+        auto&& chunk = chunks_[*index];
+        auto low = static_cast<std::uint16_t>(value);
+        if (!chunk.words.empty()) {
+            return (chunk.words[low >> 6] >> (low & 63)) & 1;
+        }
+        return std::binary_search(std::begin(chunk.array), std::end(chunk.array), low);
+    }
+
+    std::size_t Size() const noexcept {
+        return size_;
+    }
+
+    std::size_t ChunkCount() const noexcept {
+        return std::size(chunks_);
+    }
+
+    // The values of a chunk in ascending order. Chunks are in the order they were created, which is ascending after a set operation.
+    std::vector<std::uint64_t> Values(std::size_t index) const {
+        auto&& chunk = chunks_[index];
+        std::vector<std::uint64_t> values{};
+        values.reserve(chunk.count);
+        if (chunk.words.empty()) {
+            for (auto low : chunk.array) {
+                values.push_back((chunk.high << 16) | low);
+            }
+            return values;
+        }
+        for (std::size_t i = 0; i < kWords; ++i) {
+            for (auto word = chunk.words[i]; word != 0; word &= word - 1) {
+                values.push_back((chunk.high << 16) | (i << 6) | static_cast<std::uint64_t>(std::countr_zero(word)));
+            }
+        }
+        return values;
+    }
+
+    std::size_t Bytes() const noexcept {
+        return chunks_.capacity() * sizeof(Chunk) + chunkBytes_ + highs_.Bytes();
+    }
+
+    Bitmap& operator&=(const Bitmap& rhs) {
+        return Combine(rhs, false, false, [] (std::uint64_t l, std::uint64_t r) { return l & r; }, [] (auto&&... args) {
+            return std::set_intersection(args...);
+        });
+    }
+
+    Bitmap& operator|=(const Bitmap& rhs) {
+        return Combine(rhs, true, true, [] (std::uint64_t l, std::uint64_t r) { return l | r; }, [] (auto&&... args) {
+            return std::set_union(args...);
+        });
+    }
+
+    Bitmap& operator-=(const Bitmap& rhs) {
+        return Combine(rhs, true, false, [] (std::uint64_t l, std::uint64_t r) { return l & ~r; }, [] (auto&&... args) {
+            return std::set_difference(args...);
+        });
+    }
+
+private:
+    static constexpr std::size_t kWords = 1024;
+    static constexpr std::size_t kMaxArraySize = 4096;
+
+    struct Chunk {
+        std::uint64_t high{};
+        std::size_t count{};
+        std::vector<std::uint16_t> array{};
+        std::vector<std::uint64_t> words{};
+    }; // struct Chunk
+
+    static std::size_t ChunkBytes(const Chunk& chunk) noexcept {
+        return chunk.array.capacity() * sizeof(std::uint16_t) + chunk.words.capacity() * sizeof(std::uint64_t);
+    }
+
+    // The positions of the chunks in ascending order of their high bits.
+    std::vector<std::size_t> Ascending() const {
+        std::vector<std::size_t> order(std::size(chunks_));
+        std::iota(std::begin(order), std::end(order), std::size_t{0});
+        std::sort(std::begin(order), std::end(order), [&] (std::size_t lhs, std::size_t rhs) {
+            return chunks_[lhs].high < chunks_[rhs].high;
+        });
+        return order;
+    }
+
+    static void ToWords(Chunk& chunk) {
+        chunk.words.assign(kWords, 0);
+        for (auto low : chunk.array) {
+            chunk.words[low >> 6] |= std::uint64_t{1} << (low & 63);
+        }
+        std::vector<std::uint16_t>{}.swap(chunk.array);
+    }
+
+    // Recounts a chunk after a set operation and picks the smaller representation for it.
+    static void Normalize(Chunk& chunk) {
+        if (chunk.words.empty()) {
+            chunk.count = std::size(chunk.array);
+            if (chunk.count > kMaxArraySize) {
+                ToWords(chunk);
+            }
+            return;
+        }
+        chunk.count = 0;
+        for (auto word : chunk.words) {
+            chunk.count += static_cast<std::size_t>(std::popcount(word));
+        }
+        if (chunk.count <= kMaxArraySize) {
+            for (std::size_t i = 0; i < kWords; ++i) {
+                for (auto word = chunk.words[i]; word != 0; word &= word - 1) {
+                    chunk.array.push_back(static_cast<std::uint16_t>((i << 6) | static_cast<std::size_t>(std::countr_zero(word))));
+                }
+            }
+            std::vector<std::uint64_t>{}.swap(chunk.words);
+        }
+    }
+
+    // Merges the chunks of both bitmaps by their high bits. Chunks only on the left or only on the right are kept if keepLeft or keepRight;
+    // chunks on both sides are combined by wordOperation if either is a bitmap and by arrayOperation, a std::set_* algorithm, otherwise.
+    template<class TWordOperation, class TArrayOperation>
+    Bitmap& Combine(const Bitmap& rhs, bool keepLeft, bool keepRight, TWordOperation wordOperation, TArrayOperation arrayOperation) {
+        auto leftOrder = Ascending(), rightOrder = rhs.Ascending();
+        std::vector<Chunk> chunks{};
+        auto l = std::begin(leftOrder);
+        auto r = std::begin(rightOrder);
+        while ((l != std::end(leftOrder)) || (r != std::end(rightOrder))) {
+            auto i = (l != std::end(leftOrder)) ? &chunks_[*l] : nullptr;
+            auto j = (r != std::end(rightOrder)) ? &rhs.chunks_[*r] : nullptr;
+            if (!j || (i && (i->high < j->high))) {
+                if (keepLeft) {
+                    chunks.push_back(std::move(*i));
+                }
+                ++l;
+                continue;
+            }
+            if (!i || (j->high < i->high)) {
+                if (keepRight) {
+                    chunks.push_back(*j);
+                }
+                ++r;
+                continue;
+            }
+
+            auto chunk = std::move(*i);
+            if (chunk.words.empty() && j->words.empty()) {
+                std::vector<std::uint16_t> array{};
+                arrayOperation(std::begin(chunk.array), std::end(chunk.array), std::begin(j->array), std::end(j->array), std::back_inserter(array));
+                chunk.array = std::move(array);
+            } else {
+                if (chunk.words.empty()) {
+                    ToWords(chunk);
+                }
+                auto words = &j->words;
+                Chunk converted{};
+                if (words->empty()) {
+                    converted.array = j->array;
+                    ToWords(converted);
+                    words = &converted.words;
+                }
+                for (std::size_t k = 0; k < kWords; ++k) {
+                    chunk.words[k] = wordOperation(chunk.words[k], (*words)[k]);
+                }
+            }
+            Normalize(chunk);
+            if (chunk.count != 0) {
+                chunks.push_back(std::move(chunk));
+            }
+            ++l;
+            ++r;
+        }
+        chunks_ = std::move(chunks);
+        highs_ = {};
+        size_ = 0;
+        chunkBytes_ = 0;
+        for (auto&& chunk : chunks_) {
+            highs_.Insert(chunk.high);
+            size_ += chunk.count;
+            chunkBytes_ += ChunkBytes(chunk);
+        }
+        return *this;
+    }
+
+    // Chunks in the order they were created, and the number of each chunk by its high bits.
+    std::vector<Chunk> chunks_{};
+    KeyIndex<std::uint64_t, Hash<std::uint64_t>> highs_{};
+    std::size_t size_{};
+    // The bytes held by the arrays and words of all chunks, kept up to date so that Bytes doesn't have to visit every chunk.
+    std::size_t chunkBytes_{};
+}; // class Bitmap
+
+// Maps an integer to a Bitmap value, keeping the order of signed integers.
+template<class T>
+std::uint64_t ToBitmapValue(T value) noexcept {
+    if constexpr (std::is_signed_v<T>) {
+        return static_cast<std::uint64_t>(static_cast<std::int64_t>(value)) ^ (std::uint64_t{1} << 63);
+    } else {
+        return static_cast<std::uint64_t>(value);
+    }
+}
+
+template<class T>
+T FromBitmapValue(std::uint64_t value) noexcept {
+    if constexpr (std::is_signed_v<T>) {
+        return static_cast<T>(static_cast<std::int64_t>(value ^ (std::uint64_t{1} << 63)));
+    } else {
+        return static_cast<T>(value);
+    }
+}
+
+// The distinct integers seen so far: a Bitmap while they are dense enough for it, a KeyIndex once they turn out to be sparse, that is
+// once at least kMinSparseChunks chunks hold fewer than kMinChunkValues values each on average. Below that a hash table is smaller.
+template<class T>
+class IntegerSet {
+public:
+    bool Insert(T value) {
+        if (index_) {
+            return index_->Insert(value).second;
+        }
+        if (!bitmap_.Insert(ToBitmapValue(value))) {
+            return false;
+        }
+        if ((bitmap_.ChunkCount() >= kMinSparseChunks) && (bitmap_.Size() < bitmap_.ChunkCount() * kMinChunkValues)) {
+            index_.emplace();
+            for (std::size_t chunk = 0; chunk < bitmap_.ChunkCount(); ++chunk) {
+                for (auto x : bitmap_.Values(chunk)) {
+                    index_->Insert(FromBitmapValue<T>(x));
+                }
+            }
+            bitmap_ = {};
+        }
+        return true;
+    }
+
+    std::size_t Bytes() const noexcept {
+        return index_ ? index_->Bytes() : bitmap_.Bytes();
+    }
+
+private:
+    static constexpr std::size_t kMinSparseChunks = 64;
+    static constexpr std::size_t kMinChunkValues = 8;
+
+    Bitmap bitmap_{};
+    std::optional<KeyIndex<T, Hash<T>>> index_{};
+}; // class IntegerSet
+
+// K-way merge of runs that are each sorted by less. Ties go to the earlier run, so merging consecutive runs of a stable sort stays stable.
+template<class T, class TSerializer, class TLess>
+Enumerable<T> MergeSpilledRuns(std::vector<TemporaryFile> runs, TLess less) {
+    if (runs.empty()) {
+        co_return;
+    }
+    std::vector<std::optional<T>> heads{};
+    for (auto&& run : runs) {
+        run.Rewind();
+        heads.push_back(TSerializer::Read(run.Get()));
+    }
+
+    LoserTree tree{std::size(runs), [&] (std::size_t lhs, std::size_t rhs) {
+        if (!heads[lhs] || !heads[rhs]) {
+            return heads[lhs].has_value();
+        }
+        return (lhs < rhs) ? !less(*heads[rhs], *heads[lhs]) : less(*heads[lhs], *heads[rhs]);
+    }};
+    for (auto run = tree.Winner(); heads[run]; run = tree.Winner()) {
+        co_yield std::move(*heads[run]);
+        heads[run] = TSerializer::Read(runs[run].Get());
+        tree.Replay();
+    }
+}
 } // namespace detail
 
+#pragma region Serializer
+
+template<class T>
+void Serializer<T>::Write(std::FILE* file, const T& value) {
+    detail::WriteBytes(file, &value, sizeof(T));
+}
+
+template<class T>
+std::optional<T> Serializer<T>::Read(std::FILE* file) {
+    std::array<std::byte, sizeof(T)> bytes{};
+    if (!detail::ReadBytes(file, std::data(bytes), std::size(bytes))) {
+        return std::nullopt;
+    }
+    return std::bit_cast<T>(bytes);
+}
+
+template<class TChar, class TTraits, class TAllocator>
+void Serializer<std::basic_string<TChar, TTraits, TAllocator>>::Write(std::FILE* file, const std::basic_string<TChar, TTraits, TAllocator>& value) {
+    auto length = std::size(value);
+    detail::WriteBytes(file, &length, sizeof(length));
+    detail::WriteBytes(file, std::data(value), length * sizeof(TChar));
+}
+
+template<class TChar, class TTraits, class TAllocator>
+auto Serializer<std::basic_string<TChar, TTraits, TAllocator>>::Read(std::FILE* file) -> std::optional<std::basic_string<TChar, TTraits, TAllocator>> {
+    std::size_t length{};
+    if (!detail::ReadBytes(file, &length, sizeof(length))) {
+        return std::nullopt;
+    }
+    std::vector<TChar> characters{};
+    if (!detail::ReadArray(file, characters, length)) {
+        return std::nullopt;
+    }
+    return std::basic_string<TChar, TTraits, TAllocator>(std::begin(characters), std::end(characters));
+}
+
+template<class T1, class T2>
+void Serializer<std::pair<T1, T2>>::Write(std::FILE* file, const std::pair<T1, T2>& value) {
+    Serializer<T1>::Write(file, value.first);
+    Serializer<T2>::Write(file, value.second);
+}
+
+template<class T1, class T2>
+auto Serializer<std::pair<T1, T2>>::Read(std::FILE* file) -> std::optional<std::pair<T1, T2>> {
+    auto first = Serializer<T1>::Read(file);
+    if (!first) {
+        return std::nullopt;
+    }
+    auto second = Serializer<T2>::Read(file);
+    if (!second) {
+        return std::nullopt;
+    }
+    return std::pair<T1, T2>{std::move(*first), std::move(*second)};
+}
+
+#pragma endregion Serializer
+
+#pragma region Hash
+
+template<class T>
+std::size_t Hash<T>::operator()(const T& value) const {
+    if constexpr (std::is_integral_v<T> || std::is_enum_v<T>) {
+        return static_cast<std::size_t>(detail::MixHash(static_cast<std::uint64_t>(value)));
+    } else if constexpr (std::is_pointer_v<T>) {
+        return static_cast<std::size_t>(detail::MixHash(reinterpret_cast<std::uintptr_t>(value)));
+    } else {
+        return std::hash<T>{}(value);
+    }
+}
+
+template<class TChar, class TTraits, class TAllocator>
+std::size_t Hash<std::basic_string<TChar, TTraits, TAllocator>>::operator()(std::basic_string_view<TChar, TTraits> value) const noexcept {
+    return static_cast<std::size_t>(detail::HashBytes(std::data(value), std::size(value) * sizeof(TChar)));
+}
+
+#pragma endregion Hash
+
+#pragma region MemoryContext
+
+inline MemoryLimitExceeded::MemoryLimitExceeded(std::string_view name, std::size_t limit)
+    : std::runtime_error{"cpplinq: " + std::string{name} + " exceeded the memory limit of " + std::to_string(limit) + " bytes"},
+      operator_{name},
+      limit_{limit} {
+}
+
+inline const std::string& MemoryLimitExceeded::Operator() const noexcept {
+    return operator_;
+}
+
+inline std::size_t MemoryLimitExceeded::Limit() const noexcept {
+    return limit_;
+}
+
+inline MemoryContext::Scope::Scope(MemoryContext& context) noexcept : previous_{std::exchange(CurrentImpl(), &context)} {
+}
+
+inline MemoryContext::Scope::~Scope() {
+    CurrentImpl() = previous_;
+}
+
+inline MemoryContext::MemoryContext(std::size_t limit) noexcept : limit_{limit} {
+}
+
+inline MemoryContext* MemoryContext::Current() noexcept {
+    return CurrentImpl();
+}
+
+inline MemoryContext*& MemoryContext::CurrentImpl() noexcept {
+    thread_local MemoryContext* current = nullptr;
+    return current;
+}
+
+inline std::size_t MemoryContext::Limit() const noexcept {
+    return limit_;
+}
+
+inline std::size_t MemoryContext::Usage() const {
+    std::lock_guard lock{mutex_};
+    return usage_;
+}
+
+inline std::size_t MemoryContext::Available() const {
+    std::lock_guard lock{mutex_};
+    return limit_ - usage_;
+}
+
+inline std::size_t MemoryContext::Peak() const {
+    std::lock_guard lock{mutex_};
+    return peak_;
+}
+
+inline std::map<std::string, std::size_t> MemoryContext::PeakByOperator() const {
+    std::lock_guard lock{mutex_};
+    std::map<std::string, std::size_t> peaks{};
+    for (auto&& [name, account] : accounts_) {
+        peaks.emplace(name, account.peak);
+    }
+    return peaks;
+}
+
+inline void MemoryContext::Allocate(std::string_view name, std::size_t bytes) {
+    std::lock_guard lock{mutex_};
+    if (bytes > limit_ - usage_) {
+        throw MemoryLimitExceeded{name, limit_};
+    }
+    auto itr = accounts_.find(name);
+    if (itr == std::end(accounts_)) {
+        itr = accounts_.emplace(std::string{name}, Account{}).first;
+    }
+    usage_ += bytes;
+    peak_ = std::max(peak_, usage_);
+    itr->second.usage += bytes;
+    itr->second.peak = std::max(itr->second.peak, itr->second.usage);
+}
+
+inline void MemoryContext::Release(std::string_view name, std::size_t bytes) noexcept {
+    std::lock_guard lock{mutex_};
+    usage_ -= bytes;
+    if (auto itr = accounts_.find(name); itr != std::end(accounts_)) {
+        itr->second.usage -= bytes;
+    }
+}
+
+#pragma endregion MemoryContext
+
 template<class T>
 class Enumerable<T>::Controller {
 public:
+    struct Ordered;
+
+    // Elements [begin, end) of a container shared with other Enumerables, e.g. one group of GroupBy.
+    struct Slice {
+        std::shared_ptr<const Container> storage{};
+        size_type begin{};
+        size_type end{};
+    }; // struct Slice
+
     constexpr Controller() noexcept = default;
 
-    explicit Controller(promise_type& promise) : variant_{std::make_shared<Variant>(promise)} {
+    explicit Controller(promise_type& promise) : state_{std::make_shared<State>(promise)} {
     }
 
-    explicit Controller(const Container& container) : variant_{std::make_shared<Variant>(container)} {
+    explicit Controller(const Container& container) : state_{std::make_shared<State>(container)} {
+    }
+
+    explicit Controller(Ordered ordered) : state_{std::make_shared<State>(std::move(ordered))} {
+    }
+
+    explicit Controller(Slice slice) : state_{std::make_shared<State>(std::move(slice))} {
     }
 
     Controller(const Controller& rhs) noexcept = default;
@@ -98,53 +1730,159 @@ public:
     ~Controller() = default;
 
     bool operator!() const noexcept {
-        return !variant_;
+        return !state_;
     }
 
     bool IsCoroutine() const {
-        return variant_ && (variant_->index() == kCoroutineIndex);
+        return state_ && (state_->variant.index() == kCoroutineIndex);
     }
 
     const Coroutine& GetCoroutine() const {
-        return std::get<kCoroutineIndex>(*variant_);
+        return std::get<kCoroutineIndex>(state_->variant);
     }
 
     bool IsContainer() const {
-        return variant_ && (variant_->index() == kContainerIndex);
+        return state_ && (state_->variant.index() == kContainerIndex);
     }
 
     const Container& GetContainer() const {
-        return std::get<kContainerIndex>(*variant_);
+        return std::get<kContainerIndex>(state_->variant);
+    }
+
+    bool IsOrdered() const {
+        return state_ && (state_->variant.index() == kOrderedIndex);
+    }
+
+    const Ordered& GetOrdered() const {
+        return std::get<kOrderedIndex>(state_->variant);
+    }
+
+    bool IsSlice() const {
+        return state_ && (state_->variant.index() == kSliceIndex);
+    }
+
+    const Slice& GetSlice() const {
+        return std::get<kSliceIndex>(state_->variant);
+    }
+
+    // Whether the elements are held in memory, so that they can be read any number of times.
+    bool IsMaterialized() const {
+        return IsContainer() || IsSlice();
+    }
+
+    // The number of elements, if it is known without running the sequence.
+    std::optional<size_type> SizeHint() const {
+        if (IsContainer()) {
+            return std::size(GetContainer());
+        }
+        if (IsSlice()) {
+            return GetSlice().end - GetSlice().begin;
+        }
+        if (IsOrdered()) {
+            auto&& ordered = GetOrdered();
+            if (auto size = ordered.source.SizeHint()) {
+                return std::min((*size > ordered.skip) ? *size - ordered.skip : 0, ordered.take);
+            }
+        }
+        return std::nullopt;
+    }
+
+    // At most how many elements there are, if that is known without running the sequence. Unlike SizeHint, a Take over a source of
+    // unknown size bounds it.
+    std::optional<size_type> UpperBound() const {
+        if (auto size = SizeHint()) {
+            return size;
+        }
+        if (IsOrdered() && (GetOrdered().take != detail::kUnbounded)) {
+            return GetOrdered().take;
+        }
+        return std::nullopt;
     }
 
     void Flush() const {
+        if (IsOrdered()) {
+            auto ordered = std::get<kOrderedIndex>(std::move(state_->variant));
+            state_->variant = ordered.ordering->Sort(iterator{ordered.source}, end(), ordered.skip, ordered.take);
+            state_->charge = detail::MemoryCharge{"Flush"};
+            state_->charge.Update(GetContainer().capacity() * sizeof(T));
+            return;
+        }
+
         if (!IsCoroutine()) {
             return;
         }
 
         Container container{};
-        for (auto coroutine = GetCoroutine(); coroutine && !coroutine.done(); coroutine()) {
+        detail::MemoryCharge charge{"Flush"};
+        auto coroutine = GetCoroutine();
+        for (; coroutine && !coroutine.done(); coroutine()) {
             container.push_back(*coroutine.promise());
+            charge.Update(container.capacity() * sizeof(T));
+        }
+        if (coroutine) {
+            coroutine.promise().Rethrow();
         }
 
-        *variant_ = std::move(container);
+        state_->variant = std::move(container);
+        state_->charge = std::move(charge);
     }
 
     void Reset() {
-        variant_.reset();
+        state_.reset();
     }
 
 private:
-    using Variant = std::variant<detail::CoroutineHandle<T>, Container>;
+    using Variant = std::variant<detail::CoroutineHandle<T>, Container, Ordered, Slice>;
 
     enum Index {
         kCoroutineIndex = 0,
         kContainerIndex = 1,
+        kOrderedIndex = 2,
+        kSliceIndex = 3,
     };
 
-    std::shared_ptr<Variant> variant_{};
+    // The materialized container is charged for as long as it is shared, so the charge lives next to it.
+    struct State {
+        template<class U>
+        explicit State(U&& value) : variant(std::forward<U>(value)) {
+        }
+
+        Variant variant;
+        detail::MemoryCharge charge{};
+    }; // struct State
+
+    std::shared_ptr<State> state_{};
 }; // class Enumerable::Controller
 
+// A deferred OrderBy: the unsorted source plus the window [skip, skip + take) of the sorted sequence that is actually needed.
+template<class T>
+struct Enumerable<T>::Controller::Ordered {
+    Controller source{};
+    std::shared_ptr<const detail::Ordering<T>> ordering{};
+    size_type skip{};
+    size_type take{detail::kUnbounded};
+
+    Ordered Skip(int count) const {
+        auto n = static_cast<size_type>(std::max(count, 0));
+        auto result = *this;
+        result.skip = (skip > detail::kUnbounded - n) ? detail::kUnbounded : skip + n;
+        if (take != detail::kUnbounded) {
+            result.take = (take > n) ? take - n : 0;
+        }
+        return result;
+    }
+
+    Ordered Take(int count) const {
+        auto result = *this;
+        result.take = std::min(take, static_cast<size_type>(std::max(count, 0)));
+        return result;
+    }
+
+    Controller SortIncrementally() const {
+        return std::move(ordering->SortIncrementally(iterator{source}, end(), skip).controller_);
+    }
+}; // struct Enumerable::Controller::Ordered
+
 #pragma region Enumerable
 
 #pragma region constructors
@@ -153,6 +1891,10 @@ template<class T>
 Enumerable<T>::Enumerable(promise_type& promise) : controller_{promise} {
 }
 
+template<class T>
+Enumerable<T>::Enumerable(Controller controller, const std::type_info* orderedBy) : controller_{std::move(controller)}, orderedBy_{orderedBy} {
+}
+
 template<class T>
 template<class TIterator>
 Enumerable<T>::Enumerable(TIterator begin, TIterator end) : controller_{Container(begin, end)} {
@@ -161,6 +1903,7 @@ Enumerable<T>::Enumerable(TIterator begin, TIterator end) : controller_{Containe
 template<class T>
 template<class TEnumerable>
 Enumerable<T>::Enumerable(const TEnumerable& enumerable) : Enumerable{std::begin(enumerable), std::end(enumerable)} {
+    orderedBy_ = detail::ContainerOrderTag(enumerable);
 }
 
 template<class T>
@@ -180,8 +1923,9 @@ template<class T>
 auto Enumerable<T>::operator=(const Enumerable& rhs) -> Enumerable& {
     if (this != &rhs) {
         controller_ = rhs.controller_;
+        orderedBy_ = rhs.orderedBy_;
         controller_.Flush();
-        if (!controller_.IsContainer()) {
+        if (!controller_.IsMaterialized()) {
             controller_.Reset();
         }
     }
@@ -202,6 +1946,67 @@ auto Enumerable<T>::Empty() -> Enumerable {
     return {Container{}};
 }
 
+template<class T>
+auto Enumerable<T>::View(std::shared_ptr<const Container> storage, size_type begin, size_type end) -> Enumerable {
+    return Enumerable{Controller{typename Controller::Slice{std::move(storage), begin, end}}};
+}
+
+template<class T>
+auto Enumerable<T>::Views(Container rows, std::vector<size_type> groups, size_type count) -> std::vector<Enumerable> {
+    auto offsets = detail::GroupContiguously(rows, std::move(groups), count);
+    auto storage = std::make_shared<const Container>(std::move(rows));
+    std::vector<Enumerable> views{};
+    views.reserve(count);
+    for (size_type group = 0; group < count; ++group) {
+        views.push_back(View(storage, offsets[group], offsets[group + 1]));
+    }
+    return views;
+}
+
+template<class T>
+template<class TKeySelector, class TComparer>
+auto Enumerable<T>::MergeSorted(std::vector<Enumerable> sources, TKeySelector keySelector, TComparer comparer) -> Enumerable {
+    auto merged = MergeSortedImpl(std::move(sources), std::move(keySelector), std::move(comparer));
+    return Enumerable{std::move(merged.controller_), detail::OrderTag<TKeySelector, TComparer>()};
+}
+
+template<class T>
+template<class TKeySelector>
+auto Enumerable<T>::MergeSorted(std::vector<Enumerable> sources, TKeySelector keySelector) -> Enumerable {
+    return MergeSorted(std::move(sources), keySelector, std::less<std::invoke_result_t<TKeySelector, reference>>{});
+}
+
+template<class T>
+auto Enumerable<T>::MergeSorted(std::vector<Enumerable> sources) -> Enumerable {
+    return MergeSorted(std::move(sources), std::identity{}, std::less<value_type>{});
+}
+
+template<class T>
+template<class TKeySelector, class TComparer>
+auto Enumerable<T>::MergeSortedImpl(std::vector<Enumerable> sources, TKeySelector keySelector, TComparer comparer) -> Enumerable {
+    if (sources.empty()) {
+        co_return;
+    }
+    std::vector<iterator> heads{};
+    heads.reserve(std::size(sources));
+    for (auto&& source : sources) {
+        heads.push_back(std::move(source).begin());
+    }
+
+    detail::LoserTree tree{std::size(heads), [&] (std::size_t lhs, std::size_t rhs) {
+        if ((heads[lhs] == end()) || (heads[rhs] == end())) {
+            return heads[lhs] != end();
+        }
+        // Ties go to the earlier source, which takes a single comparison either way.
+        return (lhs < rhs) ? !comparer(keySelector(*heads[rhs]), keySelector(*heads[lhs])) : comparer(keySelector(*heads[lhs]), keySelector(*heads[rhs]));
+    }};
+    for (auto source = tree.Winner(); heads[source] != end(); source = tree.Winner()) {
+        co_yield *heads[source];
+        ++heads[source];
+        tree.Replay();
+    }
+}
+
 template<class T>
 auto Enumerable<T>::Range(value_type start, int count) -> Enumerable {
     for (; count > 0; ++start, --count) {
@@ -271,6 +2076,99 @@ TAccumulate Enumerable<T>::Aggregate(
     return std::move(*const_cast<Enumerable*>(this)).Aggregate(std::move(seed), aggregator);
 }
 
+template<class T>
+template<class TKeySelector, class TAccumulate, class TAggregator>
+auto Enumerable<T>::AggregateBy(
+        TKeySelector keySelector,
+        TAccumulate seed,
+        TAggregator aggregator) && -> Enumerable<std::pair<std::decay_t<std::invoke_result_t<TKeySelector, reference>>, TAccumulate>> {
+    using Key = std::decay_t<std::invoke_result_t<TKeySelector, reference>>;
+    if constexpr (detail::is_default_hashable_v<Key>) {
+        return std::move(*this).template AggregateByHash<Hash<Key>>(keySelector, std::move(seed), aggregator);
+    } else if constexpr (detail::is_default_lessable_v<Key>) {
+        return std::move(*this).template AggregateByLess<std::less<Key>>(keySelector, std::move(seed), aggregator);
+    } else {
+        //static_assert(false, "This type doesn't support std::hash and std::less. Please call AggregateByHash/AggregateByLess with specific comparer.");
+    }
+}
+
+template<class T>
+template<class TKeySelector, class TAccumulate, class TAggregator>
+auto Enumerable<T>::AggregateBy(
+        TKeySelector keySelector,
+        TAccumulate seed,
+        TAggregator aggregator) const & -> Enumerable<std::pair<std::decay_t<std::invoke_result_t<TKeySelector, reference>>, TAccumulate>> {
+    controller_.Flush();
+    return std::move(*const_cast<Enumerable*>(this)).AggregateBy(keySelector, std::move(seed), aggregator);
+}
+
+template<class T>
+template<class THash, class TKeySelector, class TAccumulate, class TAggregator>
+auto Enumerable<T>::AggregateByHash(
+        TKeySelector keySelector,
+        TAccumulate seed,
+        TAggregator aggregator) && -> Enumerable<std::pair<std::decay_t<std::invoke_result_t<TKeySelector, reference>>, TAccumulate>> {
+    using Key = std::decay_t<std::invoke_result_t<TKeySelector, reference>>;
+    detail::MemoryCharge charge{"AggregateBy"};
+    // Keys are numbered in the order they first appear, which is the order they are yielded in.
+    detail::KeyIndex<Key, THash> keys{};
+    std::vector<TAccumulate> accumulators{};
+    for (auto i = std::move(*this).begin(), j = end(); i != j; ++i) {
+        auto&& source = *i;
+        auto [index, inserted] = keys.Insert(keySelector(source));
+        if (inserted) {
+            accumulators.push_back(seed);
+            charge.Update(keys.Bytes() + accumulators.capacity() * sizeof(TAccumulate));
+        }
+        accumulators[index] = aggregator(std::move(accumulators[index]), source);
+    }
+    for (std::size_t index = 0; index < keys.Size(); ++index) {
+        co_yield std::pair<Key, TAccumulate>{keys.Keys()[index], std::move(accumulators[index])};
+    }
+}
+
+template<class T>
+template<class THash, class TKeySelector, class TAccumulate, class TAggregator>
+auto Enumerable<T>::AggregateByHash(
+        TKeySelector keySelector,
+        TAccumulate seed,
+        TAggregator aggregator) const & -> Enumerable<std::pair<std::decay_t<std::invoke_result_t<TKeySelector, reference>>, TAccumulate>> {
+    controller_.Flush();
+    return std::move(*const_cast<Enumerable*>(this)).template AggregateByHash<THash>(keySelector, std::move(seed), aggregator);
+}
+
+template<class T>
+template<class TLess, class TKeySelector, class TAccumulate, class TAggregator>
+auto Enumerable<T>::AggregateByLess(
+        TKeySelector keySelector,
+        TAccumulate seed,
+        TAggregator aggregator) && -> Enumerable<std::pair<std::decay_t<std::invoke_result_t<TKeySelector, reference>>, TAccumulate>> {
+    using Key = std::decay_t<std::invoke_result_t<TKeySelector, reference>>;
+    detail::MemoryCharge charge{"AggregateBy"};
+    std::map<Key, TAccumulate, TLess> accumulators{};
+    for (auto i = std::move(*this).begin(), j = end(); i != j; ++i) {
+        auto&& source = *i;
+        auto [itr, inserted] = accumulators.try_emplace(keySelector(source), seed);
+        if (inserted) {
+            charge.Update(std::size(accumulators) * (sizeof(Key) + sizeof(TAccumulate)));
+        }
+        itr->second = aggregator(std::move(itr->second), source);
+    }
+    for (auto&& [key, accumulator] : accumulators) {
+        co_yield std::pair<Key, TAccumulate>{key, std::move(accumulator)};
+    }
+}
+
+template<class T>
+template<class TLess, class TKeySelector, class TAccumulate, class TAggregator>
+auto Enumerable<T>::AggregateByLess(
+        TKeySelector keySelector,
+        TAccumulate seed,
+        TAggregator aggregator) const & -> Enumerable<std::pair<std::decay_t<std::invoke_result_t<TKeySelector, reference>>, TAccumulate>> {
+    controller_.Flush();
+    return std::move(*const_cast<Enumerable*>(this)).template AggregateByLess<TLess>(keySelector, std::move(seed), aggregator);
+}
+
 template<class T>
 template<class TPredicate>
 bool Enumerable<T>::All(TPredicate predicate) && {
@@ -280,59 +2178,237 @@ bool Enumerable<T>::All(TPredicate predicate) && {
             return false;
         }
     }
-    return true;
-}
-
-template<class T>
-template<class TPredicate>
-bool Enumerable<T>::All(TPredicate predicate) const & {
-    controller_.Flush();
-    return std::move(*const_cast<Enumerable*>(this)).All(predicate);
+    return true;
+}
+
+template<class T>
+template<class TPredicate>
+bool Enumerable<T>::All(TPredicate predicate) const & {
+    controller_.Flush();
+    return std::move(*const_cast<Enumerable*>(this)).All(predicate);
+}
+
+template<class T>
+template<class TPredicate>
+bool Enumerable<T>::Any(TPredicate predicate) && {
+    for (auto i = std::move(*this).begin(), j = end(); i != j; ++i) {
+        auto&& source = *i;
+        if (predicate(source)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+template<class T>
+template<class TPredicate>
+bool Enumerable<T>::Any(TPredicate predicate) const & {
+    controller_.Flush();
+    return std::move(*const_cast<Enumerable*>(this)).Any(predicate);
+}
+
+template<class T>
+bool Enumerable<T>::Any() && {
+    return std::move(*this).Any(&detail::noop_predicate<value_type>);
+}
+
+template<class T>
+bool Enumerable<T>::Any() const & {
+    controller_.Flush();
+    return std::move(*const_cast<Enumerable*>(this)).Any();
+}
+
+template<class T>
+auto Enumerable<T>::Append(value_type element) && -> Enumerable {
+    for (auto i = std::move(*this).begin(), j = end(); i != j; ++i) {
+        auto&& source = *i;
+        co_yield source;
+    }
+    co_yield element;
+}
+
+template<class T>
+auto Enumerable<T>::Append(value_type element) const & -> Enumerable {
+    controller_.Flush();
+    return std::move(*const_cast<Enumerable*>(this)).Append(std::move(element));
+}
+
+template<class T>
+template<class TEnumerable>
+BuildSide Enumerable<T>::ChooseBuildSide(const TEnumerable& inner, BuildSide side) const {
+    if (side != BuildSide::Auto) {
+        return side;
+    }
+    std::optional<size_type> innerSize{};
+    if constexpr (detail::is_enumerable_v<TEnumerable>) {
+        innerSize = inner.SizeHint();
+    } else if constexpr (std::ranges::sized_range<const TEnumerable>) {
+        innerSize = static_cast<size_type>(std::ranges::size(inner));
+    }
+    // An upper bound of the outer size is enough to tell that the outer side is the smaller one.
+    auto outerSize = UpperBound();
+    return (outerSize && innerSize && (*outerSize < *innerSize)) ? BuildSide::Outer : BuildSide::Inner;
+}
+
+template<class T>
+template<class TOperation>
+auto Enumerable<T>::CombineBitmaps(Enumerable other, TOperation operation, const char* name) && -> Enumerable {
+    static_assert(std::is_integral_v<value_type>, "Bitmap set operations need an integral element type.");
+    detail::MemoryCharge charge{name};
+    detail::Bitmap lhs{};
+    for (auto i = std::move(*this).begin(), j = end(); i != j; ++i) {
+        lhs.Insert(detail::ToBitmapValue(*i));
+        charge.Update(lhs.Bytes());
+    }
+    detail::Bitmap rhs{};
+    for (auto i = std::move(other).begin(), j = end(); i != j; ++i) {
+        rhs.Insert(detail::ToBitmapValue(*i));
+        charge.Update(lhs.Bytes() + rhs.Bytes());
+    }
+    operation(lhs, rhs);
+    rhs = {};
+    charge.Update(lhs.Bytes());
+    for (std::size_t chunk = 0; chunk < lhs.ChunkCount(); ++chunk) {
+        for (auto value : lhs.Values(chunk)) {
+            co_yield detail::FromBitmapValue<value_type>(value);
+        }
+    }
+}
+
+template<class T>
+template<class TKeyIndex, class TKeySelector, class TFilter>
+auto Enumerable<T>::Probe(const TKeyIndex& index, TKeySelector keySelector, const TFilter& filter) &&
+        -> Enumerable<std::pair<const value_type*, std::optional<std::size_t>>> {
+    using Key = std::invoke_result_t<TKeySelector, reference>;
+    if (!controller_.IsMaterialized()) {
+        for (auto i = std::move(*this).begin(), j = end(); i != j; ++i) {
+            auto&& source = *i;
+            auto&& key = keySelector(source);
+            auto hash = index.HashOf(key);
+            co_yield {&source, (!filter || filter->MayContain(hash)) ? index.Find(key, hash) : std::nullopt};
+        }
+        co_return;
+    }
+
+    // Elements held in memory stay put while the sequence runs, so a batch can point at them. Keys selected by reference are kept as
+    // pointers rather than copied.
+    using StoredKey = std::conditional_t<std::is_reference_v<Key>, const std::remove_reference_t<Key>*, Key>;
+    auto keyOf = [] (const StoredKey& key) -> decltype(auto) {
+        if constexpr (std::is_reference_v<Key>) {
+            return *key;
+        } else {
+            return key;
+        }
+    };
+    std::vector<const value_type*> sources{};
+    std::vector<StoredKey> keys{};
+    std::array<std::size_t, detail::kProbeBatchSize> hashes{};
+    std::array<bool, detail::kProbeBatchSize> candidates{};
+    sources.reserve(detail::kProbeBatchSize);
+    keys.reserve(detail::kProbeBatchSize);
+    for (auto i = std::move(*this).begin(), j = end(); i != j;) {
+        sources.clear();
+        keys.clear();
+        for (; (i != j) && (std::size(sources) < detail::kProbeBatchSize); ++i) {
+            auto&& source = *i;
+            sources.push_back(&source);
+            if constexpr (std::is_reference_v<Key>) {
+                keys.push_back(&keySelector(source));
+            } else {
+                keys.push_back(keySelector(source));
+            }
+        }
+        for (std::size_t k = 0; k < std::size(sources); ++k) {
+            hashes[k] = index.HashOf(keyOf(keys[k]));
+            if ((candidates[k] = !filter || filter->MayContain(hashes[k]))) {
+                index.PrefetchSlot(hashes[k]);
+            }
+        }
+        for (std::size_t k = 0; k < std::size(sources); ++k) {
+            if (candidates[k]) {
+                index.PrefetchEntry(hashes[k]);
+            }
+        }
+        for (std::size_t k = 0; k < std::size(sources); ++k) {
+            co_yield {sources[k], candidates[k] ? index.Find(keyOf(keys[k]), hashes[k]) : std::nullopt};
+        }
+    }
 }
 
 template<class T>
-template<class TPredicate>
-bool Enumerable<T>::Any(TPredicate predicate) && {
+template<class TLess, class TInner, class TOuterTimeSelector, class TInnerTimeSelector, class TResultSelector>
+auto Enumerable<T>::AsOfJoin(
+        Enumerable<TInner> inner,
+        TOuterTimeSelector outerTimeSelector,
+        TInnerTimeSelector innerTimeSelector,
+        TResultSelector resultSelector) && -> Enumerable<std::invoke_result_t<TResultSelector, reference, const TInner&>> {
+    TLess less{};
+    std::optional<TInner> latest{};
+    auto k = std::move(inner).begin(), l = inner.end();
     for (auto i = std::move(*this).begin(), j = end(); i != j; ++i) {
         auto&& source = *i;
-        if (predicate(source)) {
-            return true;
+        auto&& time = outerTimeSelector(source);
+        for (; (k != l) && !less(time, innerTimeSelector(*k)); ++k) {
+            latest = *k;
+        }
+        if (latest) {
+            co_yield resultSelector(source, *latest);
         }
     }
-    return false;
 }
 
 template<class T>
-template<class TPredicate>
-bool Enumerable<T>::Any(TPredicate predicate) const & {
-    controller_.Flush();
-    return std::move(*const_cast<Enumerable*>(this)).Any(predicate);
-}
-
-template<class T>
-bool Enumerable<T>::Any() && {
-    return std::move(*this).Any(&detail::noop_predicate<value_type>);
-}
-
-template<class T>
-bool Enumerable<T>::Any() const & {
+template<class TLess, class TInner, class TOuterTimeSelector, class TInnerTimeSelector, class TResultSelector>
+auto Enumerable<T>::AsOfJoin(
+        Enumerable<TInner> inner,
+        TOuterTimeSelector outerTimeSelector,
+        TInnerTimeSelector innerTimeSelector,
+        TResultSelector resultSelector) const & -> Enumerable<std::invoke_result_t<TResultSelector, reference, const TInner&>> {
     controller_.Flush();
-    return std::move(*const_cast<Enumerable*>(this)).Any();
+    return std::move(*const_cast<Enumerable*>(this)).template AsOfJoin<TLess>(std::move(inner), outerTimeSelector, innerTimeSelector, resultSelector);
 }
 
 template<class T>
-auto Enumerable<T>::Append(value_type element) && -> Enumerable {
+template<class TLess, class TInner, class TOuterKeySelector, class TInnerKeySelector, class TOuterTimeSelector, class TInnerTimeSelector, class TResultSelector>
+auto Enumerable<T>::AsOfJoin(
+        Enumerable<TInner> inner,
+        TOuterKeySelector outerKeySelector,
+        TInnerKeySelector innerKeySelector,
+        TOuterTimeSelector outerTimeSelector,
+        TInnerTimeSelector innerTimeSelector,
+        TResultSelector resultSelector) && -> Enumerable<std::invoke_result_t<TResultSelector, reference, const TInner&>> {
+    using Key = std::decay_t<std::invoke_result_t<TInnerKeySelector, const TInner&>>;
+    using Latest = std::conditional_t<detail::is_default_hashable_v<Key>, std::unordered_map<Key, TInner, Hash<Key>>, std::map<Key, TInner>>;
+    TLess less{};
+    Latest latest{};
+    detail::MemoryCharge charge{"AsOfJoin"};
+    auto k = std::move(inner).begin(), l = inner.end();
     for (auto i = std::move(*this).begin(), j = end(); i != j; ++i) {
         auto&& source = *i;
-        co_yield source;
+        auto&& time = outerTimeSelector(source);
+        for (; (k != l) && !less(time, innerTimeSelector(*k)); ++k) {
+            auto&& element = *k;
+            latest.insert_or_assign(innerKeySelector(element), element);
+            charge.Update(std::size(latest) * sizeof(typename Latest::value_type));
+        }
+        if (auto itr = latest.find(outerKeySelector(source)); itr != std::end(latest)) {
+            co_yield resultSelector(source, itr->second);
+        }
     }
-    co_yield element;
 }
 
 template<class T>
-auto Enumerable<T>::Append(value_type element) const & -> Enumerable {
+template<class TLess, class TInner, class TOuterKeySelector, class TInnerKeySelector, class TOuterTimeSelector, class TInnerTimeSelector, class TResultSelector>
+auto Enumerable<T>::AsOfJoin(
+        Enumerable<TInner> inner,
+        TOuterKeySelector outerKeySelector,
+        TInnerKeySelector innerKeySelector,
+        TOuterTimeSelector outerTimeSelector,
+        TInnerTimeSelector innerTimeSelector,
+        TResultSelector resultSelector) const & -> Enumerable<std::invoke_result_t<TResultSelector, reference, const TInner&>> {
     controller_.Flush();
-    return std::move(*const_cast<Enumerable*>(this)).Append(std::move(element));
+    return std::move(*const_cast<Enumerable*>(this)).template AsOfJoin<TLess>(
+        std::move(inner), outerKeySelector, innerKeySelector, outerTimeSelector, innerTimeSelector, resultSelector);
 }
 
 template<class T>
@@ -406,11 +2482,16 @@ auto Enumerable<T>::Count(TPredicate predicate) const & -> size_type {
 
 template<class T>
 auto Enumerable<T>::Count() && -> size_type {
+    if (controller_.IsOrdered()) {
+        auto&& ordered = controller_.GetOrdered();
+        auto n = Enumerable{ordered.source}.Count();
+        return std::min((n > ordered.skip) ? n - ordered.skip : 0, ordered.take);
+    }
     if (controller_.IsCoroutine()) {
         return std::distance(std::move(*this).begin(), end());
     }
-    if (controller_.IsContainer()) {
-        return std::size(controller_.GetContainer());
+    if (controller_.IsMaterialized()) {
+        return *controller_.SizeHint();
     }
     return {};
 }
@@ -421,6 +2502,19 @@ auto Enumerable<T>::Count() const & -> size_type {
     return std::move(*const_cast<Enumerable*>(this)).Count();
 }
 
+template<class T>
+template<class TKeySelector>
+auto Enumerable<T>::CountBy(TKeySelector keySelector) && -> Enumerable<std::pair<std::decay_t<std::invoke_result_t<TKeySelector, reference>>, size_type>> {
+    return std::move(*this).AggregateBy(keySelector, size_type{0}, [] (size_type count, reference) { return count + 1; });
+}
+
+template<class T>
+template<class TKeySelector>
+auto Enumerable<T>::CountBy(TKeySelector keySelector) const & -> Enumerable<std::pair<std::decay_t<std::invoke_result_t<TKeySelector, reference>>, size_type>> {
+    controller_.Flush();
+    return std::move(*const_cast<Enumerable*>(this)).CountBy(keySelector);
+}
+
 template<class T>
 auto Enumerable<T>::DefaultIfEmpty(value_type defaultValue) && -> Enumerable {
     if (!std::move(*this).Any()) {
@@ -438,30 +2532,110 @@ auto Enumerable<T>::DefaultIfEmpty(value_type defaultValue) const & -> Enumerabl
 template<class T>
 template<class THash>
 auto Enumerable<T>::DistinctHash() && -> Enumerable {
+    return std::move(*this).template DistinctHashImpl<THash>(std::nullopt);
+}
+
+template<class T>
+template<class THash>
+auto Enumerable<T>::DistinctHash() const & -> Enumerable {
+    controller_.Flush();
+    return std::move(*const_cast<Enumerable*>(this)).template DistinctHash<THash>();
+}
+
+template<class T>
+template<class THash>
+auto Enumerable<T>::DistinctHash(ExpectedCount expectedCount) && -> Enumerable {
+    return std::move(*this).template DistinctHashImpl<THash>(static_cast<size_type>(expectedCount));
+}
+
+template<class T>
+template<class THash>
+auto Enumerable<T>::DistinctHash(ExpectedCount expectedCount) const & -> Enumerable {
+    controller_.Flush();
+    return std::move(*const_cast<Enumerable*>(this)).template DistinctHash<THash>(expectedCount);
+}
+
+template<class T>
+template<class THash>
+auto Enumerable<T>::DistinctHashImpl(std::optional<size_type> expectedCount) && -> Enumerable {
+    detail::MemoryCharge charge{"Distinct"};
+    detail::KeyIndex<value_type, THash> values{};
+    detail::Presizer presizer{values, expectedCount, SizeHint()};
+    for (auto i = std::move(*this).begin(), j = end(); i != j; ++i) {
+        auto&& source = *i;
+        auto [number, inserted] = values.Insert(source);
+        presizer.Indexed(number);
+        if (inserted) {
+            charge.Update(values.Bytes());
+            co_yield source;
+        }
+    }
+}
+
+template<class T>
+template<class THash, class TSerializer>
+auto Enumerable<T>::DistinctHash(size_type memoryBudget) && -> Enumerable {
+    return std::move(*this).template DistinctHashImpl<THash, TSerializer>(detail::GovernedBudget(memoryBudget), 0);
+}
+
+template<class T>
+template<class THash, class TSerializer>
+auto Enumerable<T>::DistinctHash(size_type memoryBudget) const & -> Enumerable {
+    controller_.Flush();
+    return std::move(*const_cast<Enumerable*>(this)).template DistinctHash<THash, TSerializer>(memoryBudget);
+}
+
+// Hybrid hash distinct: keeps distinct elements in memory while the budget lasts and spills the elements it hasn't seen yet afterwards.
+// Every element is either held or spilled, never both, so each partition can be made distinct on its own.
+template<class T>
+template<class THash, class TSerializer>
+auto Enumerable<T>::DistinctHashImpl(size_type memoryBudget, std::size_t depth) && -> Enumerable {
+    auto capacity = std::max<size_type>(memoryBudget / sizeof(value_type), 1);
+    detail::MemoryCharge charge{"Distinct"};
     std::unordered_set<value_type, THash> values{};
+    std::vector<std::optional<detail::TemporaryFile>> partitions(detail::kSpillPartitions);
+    THash hash{};
     for (auto i = std::move(*this).begin(), j = end(); i != j; ++i) {
         auto&& source = *i;
-        values.emplace(source);
+        if (std::size(values) < capacity) {
+            values.emplace(source);
+            charge.Update(std::size(values) * sizeof(value_type));
+        } else if (!values.contains(source)) {
+            auto& partition = partitions[detail::SpillPartition(hash(source), depth)];
+            if (!partition) {
+                partition.emplace();
+            }
+            TSerializer::Write(partition->Get(), source);
+        }
     }
     for (auto&& value : values) {
         co_yield value;
     }
-}
+    std::unordered_set<value_type, THash>{}.swap(values);
+    charge.Release();
 
-template<class T>
-template<class THash>
-auto Enumerable<T>::DistinctHash() const & -> Enumerable {
-    controller_.Flush();
-    return std::move(*const_cast<Enumerable*>(this)).template DistinctHash<THash>();
+    for (auto&& partition : partitions) {
+        if (!partition) {
+            continue;
+        }
+        auto distinct = detail::ReadSpilled<value_type, TSerializer>(std::move(*partition)).template DistinctHashImpl<THash, TSerializer>(memoryBudget, depth + 1);
+        partition.reset();
+        for (auto i = std::move(distinct).begin(), j = end(); i != j; ++i) {
+            auto&& source = *i;
+            co_yield source;
+        }
+    }
 }
 
 template<class T>
 template<class TLess>
 auto Enumerable<T>::DistinctLess() && -> Enumerable {
+    detail::MemoryCharge charge{"Distinct"};
     std::set<value_type, TLess> values{};
     for (auto i = std::move(*this).begin(), j = end(); i != j; ++i) {
         auto&& source = *i;
         values.emplace(source);
+        charge.Update(std::size(values) * sizeof(value_type));
     }
     for (auto&& value : values) {
         co_yield value;
@@ -478,6 +2652,7 @@ auto Enumerable<T>::DistinctLess() const & -> Enumerable {
 template<class T>
 template<class TEqual>
 auto Enumerable<T>::DistinctEqual() && -> Enumerable {
+    detail::MemoryCharge charge{"Distinct"};
     std::vector<value_type> values{};
     TEqual equal{};
     for (auto i = std::move(*this).begin(), j = end(); i != j; ++i) {
@@ -485,6 +2660,7 @@ auto Enumerable<T>::DistinctEqual() && -> Enumerable {
         auto itr = std::find_if(std::begin(values), std::end(values), [&] (auto&& value) { return equal(source, value); });
         if (itr == std::end(values)) {
             values.emplace_back(source);
+            charge.Update(values.capacity() * sizeof(value_type));
         }
     }
     for (auto&& value : values) {
@@ -499,10 +2675,30 @@ auto Enumerable<T>::DistinctEqual() const & -> Enumerable {
     return std::move(*const_cast<Enumerable*>(this)).template DistinctEqual<TEqual>();
 }
 
+template<class T>
+auto Enumerable<T>::DistinctBitmap() && -> Enumerable {
+    static_assert(std::is_integral_v<value_type>, "DistinctBitmap needs an integral element type.");
+    detail::MemoryCharge charge{"Distinct"};
+    detail::IntegerSet<value_type> values{};
+    for (auto i = std::move(*this).begin(), j = end(); i != j; ++i) {
+        auto&& source = *i;
+        if (values.Insert(source)) {
+            charge.Update(values.Bytes());
+            co_yield source;
+        }
+    }
+}
+
+template<class T>
+auto Enumerable<T>::DistinctBitmap() const & -> Enumerable {
+    controller_.Flush();
+    return std::move(*const_cast<Enumerable*>(this)).DistinctBitmap();
+}
+
 template<class T>
 auto Enumerable<T>::Distinct() && -> Enumerable {
     if constexpr (detail::is_default_hashable_v<value_type>) {
-        return std::move(*this).template DistinctHash<std::hash<value_type>>();
+        return std::move(*this).template DistinctHash<Hash<value_type>>();
     } else if constexpr (detail::is_default_lessable_v<value_type>) {
         return std::move(*this).template DistinctLess<std::less<value_type>>();
     } else if constexpr (detail::is_default_equalable_v<value_type>) {
@@ -520,6 +2716,14 @@ auto Enumerable<T>::Distinct() const & -> Enumerable {
 
 template<class T>
 auto Enumerable<T>::ElementAt(int index, value_type defaultValue) && -> value_type {
+    if (controller_.IsOrdered() && (index >= 0)) {
+        auto ordered = controller_.GetOrdered().Skip(index);
+        if (ordered.take == 0) {
+            return defaultValue;
+        }
+        auto value = ordered.ordering->ElementAt(iterator{ordered.source}, end(), ordered.skip);
+        return value ? std::move(*value) : std::move(defaultValue);
+    }
     auto i = std::move(*this).begin(), j = end();
     for (; (index > 0) && (i != j); --index, ++i) {
     }
@@ -538,11 +2742,20 @@ auto Enumerable<T>::ElementAt(int index, value_type defaultValue) const & -> val
 template<class T>
 template<class THash>
 auto Enumerable<T>::ExceptHash(const Enumerable& other) && -> Enumerable {
-    std::unordered_set<value_type, THash> values{std::begin(other), std::end(other)};
-    for (auto i = std::move(*this).template DistinctHash<THash>().begin(), j = end(); i != j; ++i) {
-        auto&& source = *i;
-        if (values.find(source) == std::end(values)) {
-            co_yield source;
+    detail::KeyIndex<value_type, THash> values{};
+    for (auto&& value : other) {
+        values.Insert(value);
+    }
+    auto filter = detail::KeyFilter(values);
+    detail::MemoryCharge charge{"Except"};
+    charge.Update(values.Bytes() + (filter ? filter->Bytes() : 0));
+    detail::KeyIndex<value_type, THash> seen{};
+    auto probes = std::move(*this).Probe(values, std::identity{}, filter);
+    for (auto i = std::move(probes).begin(), j = probes.end(); i != j; ++i) {
+        auto&& [source, found] = *i;
+        if (!found && seen.Insert(*source).second) {
+            charge.Update(values.Bytes() + seen.Bytes() + (filter ? filter->Bytes() : 0));
+            co_yield *source;
         }
     }
 }
@@ -558,6 +2771,8 @@ template<class T>
 template<class TLess>
 auto Enumerable<T>::ExceptLess(const Enumerable& other) && -> Enumerable {
     std::set<value_type, TLess> values{std::begin(other), std::end(other)};
+    detail::MemoryCharge charge{"Except"};
+    charge.Update(std::size(values) * sizeof(value_type));
     for (auto i = std::move(*this).template DistinctLess<TLess>().begin(), j = end(); i != j; ++i) {
         auto&& source = *i;
         if (values.find(source) == std::end(values)) {
@@ -577,6 +2792,8 @@ template<class T>
 template<class TEqual>
 auto Enumerable<T>::ExceptEqual(const Enumerable& other) && -> Enumerable {
     std::vector<value_type> values{std::begin(other), std::end(other)};
+    detail::MemoryCharge charge{"Except"};
+    charge.Update(std::size(values) * sizeof(value_type));
     TEqual equal{};
     for (auto i = std::move(*this).template DistinctEqual<TEqual>().begin(), j = end(); i != j; ++i) {
         auto&& source = *i;
@@ -593,10 +2810,65 @@ auto Enumerable<T>::ExceptEqual(const Enumerable& other) const & -> Enumerable {
     return std::move(*const_cast<Enumerable*>(this)).template ExceptEqual<TEqual>(other);
 }
 
+template<class T>
+auto Enumerable<T>::ExceptBitmap(Enumerable other) && -> Enumerable {
+    auto combined = std::move(*this).CombineBitmaps(std::move(other), [] (detail::Bitmap& lhs, const detail::Bitmap& rhs) { lhs -= rhs; }, "Except");
+    return Enumerable{std::move(combined.controller_), detail::OrderTag<std::identity, std::less<value_type>>()};
+}
+
+template<class T>
+auto Enumerable<T>::ExceptBitmap(Enumerable other) const & -> Enumerable {
+    controller_.Flush();
+    return std::move(*const_cast<Enumerable*>(this)).ExceptBitmap(std::move(other));
+}
+
+template<class T>
+template<class TLess>
+auto Enumerable<T>::ExceptSorted(Enumerable other) && -> Enumerable {
+    auto merged = std::move(*this).template ExceptSortedImpl<TLess>(std::move(other));
+    return Enumerable{std::move(merged.controller_), detail::OrderTag<std::identity, TLess>()};
+}
+
+template<class T>
+template<class TLess>
+auto Enumerable<T>::ExceptSorted(Enumerable other) const & -> Enumerable {
+    controller_.Flush();
+    return std::move(*const_cast<Enumerable*>(this)).template ExceptSorted<TLess>(std::move(other));
+}
+
+template<class T>
+template<class TLess>
+auto Enumerable<T>::ExceptSortedImpl(Enumerable other) && -> Enumerable {
+    TLess less{};
+    std::optional<value_type> last{};
+    auto i = std::move(*this).begin();
+    auto j = std::move(other).begin();
+    for (auto k = end(); i != k; ++i) {
+        auto&& source = *i;
+        while ((j != k) && less(*j, source)) {
+            ++j;
+        }
+        if (((j == k) || less(source, *j)) && (!last || less(*last, source))) {
+            last = source;
+            co_yield *last;
+        }
+    }
+}
+
 template<class T>
 auto Enumerable<T>::Except(const Enumerable& other) && -> Enumerable {
+    if constexpr (detail::is_default_lessable_v<value_type>) {
+        if (IsOrderedBy<std::identity, std::less<value_type>>() && other.IsOrderedBy<std::identity, std::less<value_type>>()) {
+            return std::move(*this).template ExceptSorted<std::less<value_type>>(other);
+        }
+    }
+    if constexpr (requires (const value_type& value) { value > value; }) {
+        if (IsOrderedBy<std::identity, std::greater<value_type>>() && other.IsOrderedBy<std::identity, std::greater<value_type>>()) {
+            return std::move(*this).template ExceptSorted<std::greater<value_type>>(other);
+        }
+    }
     if constexpr (detail::is_default_hashable_v<value_type>) {
-        return std::move(*this).template ExceptHash<std::hash<value_type>>(other);
+        return std::move(*this).template ExceptHash<Hash<value_type>>(other);
     } else if constexpr (detail::is_default_lessable_v<value_type>) {
         return std::move(*this).template ExceptLess<std::less<value_type>>(other);
     } else if constexpr (detail::is_default_equalable_v<value_type>) {
@@ -633,6 +2905,9 @@ auto Enumerable<T>::First(TPredicate predicate, value_type defaultValue) const &
 
 template<class T>
 auto Enumerable<T>::First(value_type defaultValue) && -> value_type {
+    if (controller_.IsOrdered()) {
+        return Enumerable{Controller{controller_.GetOrdered().Take(1)}}.First(&detail::noop_predicate<value_type>, std::move(defaultValue));
+    }
     return std::move(*this).First(&detail::noop_predicate<value_type>, std::move(defaultValue));
 }
 
@@ -648,14 +2923,7 @@ auto Enumerable<T>::GroupByHash(
         TKeySelector keySelector,
         TElementSelector elementSelector,
         TResultSelector resultSelector) && -> Enumerable<std::invoke_result_t<TResultSelector, std::invoke_result_t<TKeySelector, reference>, Enumerable<std::invoke_result_t<TElementSelector, reference>>>> {
-    std::unordered_map<std::invoke_result_t<TKeySelector, reference>, std::vector<std::invoke_result_t<TElementSelector, reference>>, THash> values{};
-    for (auto i = std::move(*this).begin(), j = end(); i != j; ++i) {
-        auto&& source = *i;
-        values[keySelector(source)].emplace_back(elementSelector(source));
-    }
-    for (auto&& [key, elements] : values) {
-        co_yield resultSelector(key, elements);
-    }
+    return std::move(*this).template GroupByHashImpl<THash>(keySelector, elementSelector, resultSelector, std::nullopt);
 }
 
 template<class T>
@@ -668,19 +2936,192 @@ auto Enumerable<T>::GroupByHash(
     return std::move(*const_cast<Enumerable*>(this)).template GroupByHash<THash>(keySelector, elementSelector, resultSelector);
 }
 
+template<class T>
+template<class THash, class TSerializer, class TKeySelector, class TElementSelector, class TResultSelector>
+auto Enumerable<T>::GroupByHash(
+        TKeySelector keySelector,
+        TElementSelector elementSelector,
+        TResultSelector resultSelector,
+        size_type memoryBudget) && -> Enumerable<std::invoke_result_t<TResultSelector, std::invoke_result_t<TKeySelector, reference>, Enumerable<std::invoke_result_t<TElementSelector, reference>>>> {
+    return std::move(*this).template GroupByHashImpl<THash, TSerializer>(keySelector, elementSelector, resultSelector, detail::GovernedBudget(memoryBudget), 0);
+}
+
+template<class T>
+template<class THash, class TSerializer, class TKeySelector, class TElementSelector, class TResultSelector>
+auto Enumerable<T>::GroupByHash(
+        TKeySelector keySelector,
+        TElementSelector elementSelector,
+        TResultSelector resultSelector,
+        size_type memoryBudget) const & -> Enumerable<std::invoke_result_t<TResultSelector, std::invoke_result_t<TKeySelector, reference>, Enumerable<std::invoke_result_t<TElementSelector, reference>>>> {
+    controller_.Flush();
+    return std::move(*const_cast<Enumerable*>(this)).template GroupByHash<THash, TSerializer>(keySelector, elementSelector, resultSelector, memoryBudget);
+}
+
+template<class T>
+template<class THash, class TKeySelector, class TElementSelector, class TResultSelector>
+auto Enumerable<T>::GroupByHash(
+        TKeySelector keySelector,
+        TElementSelector elementSelector,
+        TResultSelector resultSelector,
+        ExpectedCount expectedCount) && -> Enumerable<std::invoke_result_t<TResultSelector, std::invoke_result_t<TKeySelector, reference>, Enumerable<std::invoke_result_t<TElementSelector, reference>>>> {
+    return std::move(*this).template GroupByHashImpl<THash>(keySelector, elementSelector, resultSelector, static_cast<size_type>(expectedCount));
+}
+
+template<class T>
+template<class THash, class TKeySelector, class TElementSelector, class TResultSelector>
+auto Enumerable<T>::GroupByHash(
+        TKeySelector keySelector,
+        TElementSelector elementSelector,
+        TResultSelector resultSelector,
+        ExpectedCount expectedCount) const & -> Enumerable<std::invoke_result_t<TResultSelector, std::invoke_result_t<TKeySelector, reference>, Enumerable<std::invoke_result_t<TElementSelector, reference>>>> {
+    controller_.Flush();
+    return std::move(*const_cast<Enumerable*>(this)).template GroupByHash<THash>(keySelector, elementSelector, resultSelector, expectedCount);
+}
+
+template<class T>
+template<class THash, class TKeySelector, class TElementSelector, class TResultSelector>
+auto Enumerable<T>::GroupByHashImpl(
+        TKeySelector keySelector,
+        TElementSelector elementSelector,
+        TResultSelector resultSelector,
+        std::optional<size_type> expectedCount) && -> Enumerable<std::invoke_result_t<TResultSelector, std::invoke_result_t<TKeySelector, reference>, Enumerable<std::invoke_result_t<TElementSelector, reference>>>> {
+    using Key = std::invoke_result_t<TKeySelector, reference>;
+    using Element = std::invoke_result_t<TElementSelector, reference>;
+    detail::MemoryCharge charge{"GroupBy"};
+    detail::KeyIndex<Key, THash> keys{};
+    std::vector<Element> rows{};
+    std::vector<size_type> groups{};
+    detail::Presizer presizer{keys, expectedCount, SizeHint()};
+    for (auto i = std::move(*this).begin(), j = end(); i != j; ++i) {
+        auto&& source = *i;
+        groups.push_back(keys.Insert(keySelector(source)).first);
+        presizer.Indexed(groups.back());
+        rows.emplace_back(elementSelector(source));
+        charge.Update(keys.Bytes() + std::size(rows) * (sizeof(Element) + sizeof(size_type)));
+    }
+    auto offsets = detail::GroupContiguously(rows, std::move(groups), keys.Size());
+    auto elements = std::make_shared<const std::vector<Element>>(std::move(rows));
+    for (size_type group = 0; group < keys.Size(); ++group) {
+        co_yield resultSelector(keys.Keys()[group], Enumerable<Element>::View(elements, offsets[group], offsets[group + 1]));
+    }
+}
+
+// Hybrid hash aggregation: the source elements of every group are kept in kSpillPartitions hash partitions, and whenever the budget is
+// exceeded the largest partition still in memory is written to a temporary file, groups and all. Elements of a spilled partition go
+// straight to its file from then on, so every key is either held or spilled as a whole and each file can be grouped on its own.
+template<class T>
+template<class THash, class TSerializer, class TKeySelector, class TElementSelector, class TResultSelector>
+auto Enumerable<T>::GroupByHashImpl(
+        TKeySelector keySelector,
+        TElementSelector elementSelector,
+        TResultSelector resultSelector,
+        size_type memoryBudget,
+        std::size_t depth) && -> Enumerable<std::invoke_result_t<TResultSelector, std::invoke_result_t<TKeySelector, reference>, Enumerable<std::invoke_result_t<TElementSelector, reference>>>> {
+    using Key = std::invoke_result_t<TKeySelector, reference>;
+    using Element = std::invoke_result_t<TElementSelector, reference>;
+    using Groups = std::unordered_map<Key, std::vector<value_type>, THash>;
+
+    struct Partition {
+        Groups groups{};
+        std::optional<detail::TemporaryFile> file{};
+        size_type usage{};
+    };
+
+    std::vector<Partition> partitions(detail::kSpillPartitions);
+    THash hash{};
+    detail::MemoryCharge charge{"GroupBy"};
+    size_type usage = 0;
+    for (auto i = std::move(*this).begin(), j = end(); i != j; ++i) {
+        auto&& source = *i;
+        auto key = keySelector(source);
+        auto& partition = partitions[detail::SpillPartition(hash(key), depth)];
+        if (partition.file) {
+            TSerializer::Write(partition.file->Get(), source);
+            continue;
+        }
+        auto [itr, inserted] = partition.groups.try_emplace(std::move(key));
+        itr->second.push_back(source);
+        auto bytes = (inserted ? sizeof(Key) : 0) + sizeof(value_type);
+        partition.usage += bytes;
+        usage += bytes;
+        while ((usage > memoryBudget) && (depth < detail::kMaxSpillDepth)) {
+            auto& largest = *std::max_element(std::begin(partitions), std::end(partitions), [] (auto&& lhs, auto&& rhs) {
+                return lhs.usage < rhs.usage;
+            });
+            largest.file.emplace();
+            for (auto&& [_, rows] : largest.groups) {
+                for (auto&& row : rows) {
+                    TSerializer::Write(largest.file->Get(), row);
+                }
+            }
+            usage -= std::exchange(largest.usage, 0);
+            Groups{}.swap(largest.groups);
+        }
+        charge.Update(usage);
+    }
+    for (auto&& partition : partitions) {
+        // The groups of a partition share one buffer of elements.
+        std::vector<Element> elements{};
+        elements.reserve(std::accumulate(std::begin(partition.groups), std::end(partition.groups), size_type{0}, [] (size_type n, auto&& group) {
+            return n + std::size(group.second);
+        }));
+        std::vector<size_type> offsets{0};
+        for (auto&& [_, rows] : partition.groups) {
+            for (auto&& row : rows) {
+                elements.emplace_back(elementSelector(row));
+            }
+            offsets.push_back(std::size(elements));
+            std::vector<value_type>{}.swap(rows);
+        }
+        auto storage = std::make_shared<const std::vector<Element>>(std::move(elements));
+        size_type group = 0;
+        for (auto&& [key, _] : partition.groups) {
+            co_yield resultSelector(key, Enumerable<Element>::View(storage, offsets[group], offsets[group + 1]));
+            ++group;
+        }
+    }
+    for (auto&& partition : partitions) {
+        Groups{}.swap(partition.groups);
+    }
+    charge.Release();
+
+    for (auto&& partition : partitions) {
+        if (!partition.file) {
+            continue;
+        }
+        auto groups = detail::ReadSpilled<value_type, TSerializer>(std::move(*partition.file))
+            .template GroupByHashImpl<THash, TSerializer>(keySelector, elementSelector, resultSelector, memoryBudget, depth + 1);
+        partition.file.reset();
+        for (auto i = std::move(groups).begin(), j = groups.end(); i != j; ++i) {
+            auto&& source = *i;
+            co_yield source;
+        }
+    }
+}
+
 template<class T>
 template<class TLess, class TKeySelector, class TElementSelector, class TResultSelector>
 auto Enumerable<T>::GroupByLess(
         TKeySelector keySelector,
         TElementSelector elementSelector,
         TResultSelector resultSelector) && -> Enumerable<std::invoke_result_t<TResultSelector, std::invoke_result_t<TKeySelector, reference>, Enumerable<std::invoke_result_t<TElementSelector, reference>>>> {
-    std::map<std::invoke_result_t<TKeySelector, reference>, std::vector<std::invoke_result_t<TElementSelector, reference>>, TLess> values{};
+    using Key = std::invoke_result_t<TKeySelector, reference>;
+    using Element = std::invoke_result_t<TElementSelector, reference>;
+    detail::MemoryCharge charge{"GroupBy"};
+    std::map<Key, size_type, TLess> indices{};
+    std::vector<Element> rows{};
+    std::vector<size_type> groups{};
     for (auto i = std::move(*this).begin(), j = end(); i != j; ++i) {
         auto&& source = *i;
-        values[keySelector(source)].emplace_back(elementSelector(source));
+        auto itr = indices.try_emplace(keySelector(source), std::size(indices)).first;
+        groups.push_back(itr->second);
+        rows.emplace_back(elementSelector(source));
+        charge.Update(std::size(indices) * sizeof(Key) + std::size(rows) * (sizeof(Element) + sizeof(size_type)));
     }
-    for (auto&& [key, elements] : values) {
-        co_yield resultSelector(key, elements);
+    auto offsets = detail::GroupContiguously(rows, std::move(groups), std::size(indices));
+    auto elements = std::make_shared<const std::vector<Element>>(std::move(rows));
+    for (auto&& [key, group] : indices) {
+        co_yield resultSelector(key, Enumerable<Element>::View(elements, offsets[group], offsets[group + 1]));
     }
 }
 
@@ -700,21 +3141,28 @@ auto Enumerable<T>::GroupByEqual(
         TKeySelector keySelector,
         TElementSelector elementSelector,
         TResultSelector resultSelector) && -> Enumerable<std::invoke_result_t<TResultSelector, std::invoke_result_t<TKeySelector, reference>, Enumerable<std::invoke_result_t<TElementSelector, reference>>>> {
-    std::vector<std::pair<std::invoke_result_t<TKeySelector, reference>, std::vector<std::invoke_result_t<TElementSelector, reference>>>> values{};
+    using Key = std::invoke_result_t<TKeySelector, reference>;
+    using Element = std::invoke_result_t<TElementSelector, reference>;
+    detail::MemoryCharge charge{"GroupBy"};
+    std::vector<Key> keys{};
+    std::vector<Element> rows{};
+    std::vector<size_type> groups{};
     TEqual equal{};
     for (auto i = std::move(*this).begin(), j = end(); i != j; ++i) {
         auto&& source = *i;
         auto key = keySelector(source);
-        auto element = elementSelector(source);
-        auto itr = std::find_if(std::begin(values), std::end(values), [&] (auto&& value) { return value.first == key; });
-        if (itr == std::end(values)) {
-            values.push_back({key, {element}});
-        } else {
-            itr->second.emplace_back(element);
+        auto itr = std::find_if(std::begin(keys), std::end(keys), [&] (auto&& value) { return equal(value, key); });
+        groups.push_back(itr - std::begin(keys));
+        if (itr == std::end(keys)) {
+            keys.push_back(std::move(key));
         }
+        rows.emplace_back(elementSelector(source));
+        charge.Update(std::size(keys) * sizeof(Key) + std::size(rows) * (sizeof(Element) + sizeof(size_type)));
     }
-    for (auto&& [key, elements] : values) {
-        co_yield resultSelector(key, elements);
+    auto offsets = detail::GroupContiguously(rows, std::move(groups), std::size(keys));
+    auto elements = std::make_shared<const std::vector<Element>>(std::move(rows));
+    for (size_type group = 0; group < std::size(keys); ++group) {
+        co_yield resultSelector(keys[group], Enumerable<Element>::View(elements, offsets[group], offsets[group + 1]));
     }
 }
 
@@ -736,7 +3184,7 @@ auto Enumerable<T>::GroupBy(
         TResultSelector resultSelector) && -> Enumerable<std::invoke_result_t<TResultSelector, std::invoke_result_t<TKeySelector, reference>, Enumerable<std::invoke_result_t<TElementSelector, reference>>>> {
     using Key = std::invoke_result_t<TKeySelector, reference>;
     if constexpr (detail::is_default_hashable_v<Key>) {
-        return std::move(*this).template GroupByHash<std::hash<Key>>(keySelector, elementSelector, resultSelector);
+        return std::move(*this).template GroupByHash<Hash<Key>>(keySelector, elementSelector, resultSelector);
     } else if constexpr (detail::is_default_lessable_v<Key>) {
         return std::move(*this).template GroupByLess<std::less<Key>>(keySelector, elementSelector, resultSelector);
     } else if constexpr (detail::is_default_equalable_v<Key>) {
@@ -757,20 +3205,61 @@ auto Enumerable<T>::GroupBy(
 }
 
 template<class T>
-template<class TKeySelector, class TElementSelector>
-auto Enumerable<T>::GroupBy(
-        TKeySelector keySelector,
-        TElementSelector elementSelector) && -> Enumerable<Grouping<std::invoke_result_t<TKeySelector, reference>, std::invoke_result_t<TElementSelector, reference>>> {
-    return std::move(*this).GroupBy(keySelector, elementSelector, [] (auto&& key, auto&& elements) { return Grouping{key, elements}; });
+template<class TKeySelector, class TElementSelector>
+auto Enumerable<T>::GroupBy(
+        TKeySelector keySelector,
+        TElementSelector elementSelector) && -> Enumerable<Grouping<std::invoke_result_t<TKeySelector, reference>, std::invoke_result_t<TElementSelector, reference>>> {
+    return std::move(*this).GroupBy(keySelector, elementSelector, [] (auto&& key, auto&& elements) { return Grouping{key, elements}; });
+}
+
+template<class T>
+template<class TKeySelector, class TElementSelector>
+auto Enumerable<T>::GroupBy(
+        TKeySelector keySelector,
+        TElementSelector elementSelector) const & -> Enumerable<Grouping<std::invoke_result_t<TKeySelector, reference>, std::invoke_result_t<TElementSelector, reference>>> {
+    controller_.Flush();
+    return std::move(*const_cast<Enumerable*>(this)).GroupBy(keySelector, elementSelector);
+}
+
+template<class T>
+template<class THash, class TEnumerable, class TOuterKeySelector, class TInnerKeySelector, class TResultSelector>
+auto Enumerable<T>::GroupJoinHash(
+        const TEnumerable& inner,
+        TOuterKeySelector outerKeySelector,
+        TInnerKeySelector innerKeySelector,
+        TResultSelector resultSelector) && -> Enumerable<std::invoke_result_t<TResultSelector, reference, const Enumerable<std::decay_t<decltype(*std::begin(inner))>>&>> {
+    return std::move(*this).template GroupJoinHash<THash>(inner, outerKeySelector, innerKeySelector, resultSelector, BuildSide::Auto);
+}
+
+template<class T>
+template<class THash, class U, class TOuterKeySelector, class TInnerKeySelector, class TResultSelector>
+auto Enumerable<T>::GroupJoinHash(
+        std::initializer_list<U> inner,
+        TOuterKeySelector outerKeySelector,
+        TInnerKeySelector innerKeySelector,
+        TResultSelector resultSelector) && -> Enumerable<std::invoke_result_t<TResultSelector, reference, const Enumerable<U>&>> {
+    return std::move(*this).template GroupJoinHash<THash, std::initializer_list<U>>(inner, outerKeySelector, innerKeySelector, resultSelector);
+}
+
+template<class T>
+template<class THash, class TEnumerable, class TOuterKeySelector, class TInnerKeySelector, class TResultSelector>
+auto Enumerable<T>::GroupJoinHash(
+        const TEnumerable& inner,
+        TOuterKeySelector outerKeySelector,
+        TInnerKeySelector innerKeySelector,
+        TResultSelector resultSelector) const & -> Enumerable<std::invoke_result_t<TResultSelector, reference, const Enumerable<std::decay_t<decltype(*std::begin(inner))>>&>> {
+    controller_.Flush();
+    return std::move(*const_cast<Enumerable*>(this)).template GroupJoinHash<THash>(inner, outerKeySelector, innerKeySelector, resultSelector);
 }
 
 template<class T>
-template<class TKeySelector, class TElementSelector>
-auto Enumerable<T>::GroupBy(
-        TKeySelector keySelector,
-        TElementSelector elementSelector) const & -> Enumerable<Grouping<std::invoke_result_t<TKeySelector, reference>, std::invoke_result_t<TElementSelector, reference>>> {
-    controller_.Flush();
-    return std::move(*const_cast<Enumerable*>(this)).GroupBy(keySelector, elementSelector);
+template<class THash, class U, class TOuterKeySelector, class TInnerKeySelector, class TResultSelector>
+auto Enumerable<T>::GroupJoinHash(
+        std::initializer_list<U> inner,
+        TOuterKeySelector outerKeySelector,
+        TInnerKeySelector innerKeySelector,
+        TResultSelector resultSelector) const & -> Enumerable<std::invoke_result_t<TResultSelector, reference, const Enumerable<U>&>> {
+    return GroupJoinHash<THash, std::initializer_list<U>>(inner, outerKeySelector, innerKeySelector, resultSelector);
 }
 
 template<class T>
@@ -779,19 +3268,57 @@ auto Enumerable<T>::GroupJoinHash(
         const TEnumerable& inner,
         TOuterKeySelector outerKeySelector,
         TInnerKeySelector innerKeySelector,
-        TResultSelector resultSelector) && -> Enumerable<std::invoke_result_t<TResultSelector, reference, const Enumerable<std::decay_t<decltype(*std::begin(inner))>>&>> {
-    std::unordered_multimap<std::invoke_result_t<TOuterKeySelector, reference>, std::pair<value_type, std::vector<std::decay_t<decltype(*std::begin(inner))>>>, THash> values{};
+        TResultSelector resultSelector,
+        BuildSide side) && -> Enumerable<std::invoke_result_t<TResultSelector, reference, const Enumerable<std::decay_t<decltype(*std::begin(inner))>>&>> {
+    using Key = std::invoke_result_t<TOuterKeySelector, reference>;
+    using Inner = std::decay_t<decltype(*std::begin(inner))>;
+    detail::MemoryCharge charge{"GroupJoin"};
+    detail::KeyIndex<Key, THash> indices{};
+    std::vector<Inner> rows{};
+    std::vector<size_type> groups{};
+    size_type usage = 0;
+    if (ChooseBuildSide(inner, side) == BuildSide::Inner) {
+        for (auto&& element : inner) {
+            auto [group, inserted] = indices.Insert(innerKeySelector(element));
+            groups.push_back(group);
+            rows.emplace_back(element);
+            usage += (inserted ? sizeof(Enumerable<Inner>) : 0) + sizeof(Inner) + sizeof(size_type);
+            charge.Update(indices.Bytes() + usage);
+        }
+        // Outer elements with the same key share the view of their group.
+        auto views = Enumerable<Inner>::Views(std::move(rows), std::move(groups), indices.Size());
+        const auto none = Enumerable<Inner>::Empty();
+        auto probes = std::move(*this).Probe(indices, outerKeySelector, std::optional<detail::BloomFilter>{});
+        for (auto i = std::move(probes).begin(), j = probes.end(); i != j; ++i) {
+            auto&& [source, group] = *i;
+            co_yield resultSelector(*source, group ? views[*group] : none);
+        }
+        co_return;
+    }
+
+    // Outer elements are kept in their original order, each with the group of its key, so that inner elements only need to be kept if
+    // they match.
+    std::vector<value_type> outers{};
+    std::vector<size_type> outerGroups{};
     for (auto i = std::move(*this).begin(), j = end(); i != j; ++i) {
         auto&& source = *i;
-        values.insert({outerKeySelector(source), {source, {}}});
+        auto [group, inserted] = indices.Insert(outerKeySelector(source));
+        outers.emplace_back(source);
+        outerGroups.push_back(group);
+        usage += sizeof(value_type) + sizeof(size_type) + (inserted ? sizeof(Enumerable<Inner>) : 0);
+        charge.Update(indices.Bytes() + usage);
     }
     for (auto&& element : inner) {
-        for (auto&& [i, j] = values.equal_range(innerKeySelector(element)); i != j; ++i) {
-            i->second.second.emplace_back(element);
+        if (auto group = indices.Find(innerKeySelector(element))) {
+            groups.push_back(*group);
+            rows.emplace_back(element);
+            usage += sizeof(Inner) + sizeof(size_type);
+            charge.Update(indices.Bytes() + usage);
         }
     }
-    for (auto&& value : values) {
-        co_yield resultSelector(value.second.first, value.second.second);
+    auto views = Enumerable<Inner>::Views(std::move(rows), std::move(groups), indices.Size());
+    for (size_type i = 0; i < std::size(outers); ++i) {
+        co_yield resultSelector(outers[i], views[outerGroups[i]]);
     }
 }
 
@@ -801,8 +3328,9 @@ auto Enumerable<T>::GroupJoinHash(
         std::initializer_list<U> inner,
         TOuterKeySelector outerKeySelector,
         TInnerKeySelector innerKeySelector,
-        TResultSelector resultSelector) && -> Enumerable<std::invoke_result_t<TResultSelector, reference, const Enumerable<U>&>> {
-    return std::move(*this).template GroupJoinHash<THash, std::initializer_list<U>>(inner, outerKeySelector, innerKeySelector, resultSelector);
+        TResultSelector resultSelector,
+        BuildSide side) && -> Enumerable<std::invoke_result_t<TResultSelector, reference, const Enumerable<U>&>> {
+    return std::move(*this).template GroupJoinHash<THash, std::initializer_list<U>>(inner, outerKeySelector, innerKeySelector, resultSelector, side);
 }
 
 template<class T>
@@ -811,9 +3339,10 @@ auto Enumerable<T>::GroupJoinHash(
         const TEnumerable& inner,
         TOuterKeySelector outerKeySelector,
         TInnerKeySelector innerKeySelector,
-        TResultSelector resultSelector) const & -> Enumerable<std::invoke_result_t<TResultSelector, reference, const Enumerable<std::decay_t<decltype(*std::begin(inner))>>&>> {
+        TResultSelector resultSelector,
+        BuildSide side) const & -> Enumerable<std::invoke_result_t<TResultSelector, reference, const Enumerable<std::decay_t<decltype(*std::begin(inner))>>&>> {
     controller_.Flush();
-    return std::move(*const_cast<Enumerable*>(this)).template GroupJoinHash<THash>(inner, outerKeySelector, innerKeySelector, resultSelector);
+    return std::move(*const_cast<Enumerable*>(this)).template GroupJoinHash<THash>(inner, outerKeySelector, innerKeySelector, resultSelector, side);
 }
 
 template<class T>
@@ -822,8 +3351,95 @@ auto Enumerable<T>::GroupJoinHash(
         std::initializer_list<U> inner,
         TOuterKeySelector outerKeySelector,
         TInnerKeySelector innerKeySelector,
-        TResultSelector resultSelector) const & -> Enumerable<std::invoke_result_t<TResultSelector, reference, const Enumerable<U>&>> {
-    return GroupJoinHash<THash, std::initializer_list<U>>(inner, outerKeySelector, innerKeySelector, resultSelector);
+        TResultSelector resultSelector,
+        BuildSide side) const & -> Enumerable<std::invoke_result_t<TResultSelector, reference, const Enumerable<U>&>> {
+    return GroupJoinHash<THash, std::initializer_list<U>>(inner, outerKeySelector, innerKeySelector, resultSelector, side);
+}
+
+template<class T>
+template<class THash, class TSerializer, class TInnerSerializer, class TEnumerable, class TOuterKeySelector, class TInnerKeySelector, class TResultSelector>
+auto Enumerable<T>::GroupJoinHash(
+        const TEnumerable& inner,
+        TOuterKeySelector outerKeySelector,
+        TInnerKeySelector innerKeySelector,
+        TResultSelector resultSelector,
+        size_type memoryBudget) && -> Enumerable<std::invoke_result_t<TResultSelector, reference, const Enumerable<std::decay_t<decltype(*std::begin(inner))>>&>> {
+    using Inner = std::decay_t<decltype(*std::begin(inner))>;
+    using InnerSerializer = std::conditional_t<std::is_void_v<TInnerSerializer>, Serializer<Inner>, TInnerSerializer>;
+    return std::move(*this).template GroupJoinHashImpl<THash, TSerializer, InnerSerializer>(
+        detail::Stream<Inner>(inner),
+        outerKeySelector,
+        innerKeySelector,
+        resultSelector,
+        detail::GovernedBudget(memoryBudget),
+        0);
+}
+
+template<class T>
+template<class THash, class TSerializer, class TInnerSerializer, class TEnumerable, class TOuterKeySelector, class TInnerKeySelector, class TResultSelector>
+auto Enumerable<T>::GroupJoinHash(
+        const TEnumerable& inner,
+        TOuterKeySelector outerKeySelector,
+        TInnerKeySelector innerKeySelector,
+        TResultSelector resultSelector,
+        size_type memoryBudget) const & -> Enumerable<std::invoke_result_t<TResultSelector, reference, const Enumerable<std::decay_t<decltype(*std::begin(inner))>>&>> {
+    controller_.Flush();
+    return std::move(*const_cast<Enumerable*>(this)).template GroupJoinHash<THash, TSerializer, TInnerSerializer>(inner, outerKeySelector, innerKeySelector, resultSelector, memoryBudget);
+}
+
+// Hybrid hash group join: outer elements whose partition stayed in memory are answered in order; the others are spilled next to their
+// inner partition and each such pair is group joined one level deeper.
+template<class T>
+template<class THash, class TSerializer, class TInnerSerializer, class TInner, class TOuterKeySelector, class TInnerKeySelector, class TResultSelector>
+auto Enumerable<T>::GroupJoinHashImpl(
+        Enumerable<TInner> inner,
+        TOuterKeySelector outerKeySelector,
+        TInnerKeySelector innerKeySelector,
+        TResultSelector resultSelector,
+        size_type memoryBudget,
+        std::size_t depth) && -> Enumerable<std::invoke_result_t<TResultSelector, reference, const Enumerable<TInner>&>> {
+    detail::SpillingMultimap<std::invoke_result_t<TInnerKeySelector, const TInner&>, TInner, THash, TInnerSerializer> values{memoryBudget, depth, "GroupJoin"};
+    for (auto i = std::move(inner).begin(), j = inner.end(); i != j; ++i) {
+        auto&& element = *i;
+        values.Insert(innerKeySelector(element), element);
+    }
+
+    std::vector<std::optional<detail::TemporaryFile>> outers(detail::kSpillPartitions);
+    for (auto i = std::move(*this).begin(), j = end(); i != j; ++i) {
+        auto&& source = *i;
+        auto key = outerKeySelector(source);
+        if (auto partition = values.PartitionOf(key); values.IsSpilled(partition)) {
+            if (!outers[partition]) {
+                outers[partition].emplace();
+            }
+            TSerializer::Write(outers[partition]->Get(), source);
+            continue;
+        }
+        std::vector<TInner> elements{};
+        for (auto&& [l, r] = values.EqualRange(key); l != r; ++l) {
+            elements.emplace_back(l->second);
+        }
+        co_yield resultSelector(source, elements);
+    }
+
+    auto inners = values.Release();
+    for (std::size_t partition = 0; partition < detail::kSpillPartitions; ++partition) {
+        if (!outers[partition]) {
+            continue;
+        }
+        auto joined = detail::ReadSpilled<value_type, TSerializer>(std::move(*outers[partition]))
+            .template GroupJoinHashImpl<THash, TSerializer, TInnerSerializer>(
+                detail::ReadSpilled<TInner, TInnerSerializer>(std::move(*inners[partition])),
+                outerKeySelector,
+                innerKeySelector,
+                resultSelector,
+                memoryBudget,
+                depth + 1);
+        for (auto i = std::move(joined).begin(), j = joined.end(); i != j; ++i) {
+            auto&& result = *i;
+            co_yield result;
+        }
+    }
 }
 
 template<class T>
@@ -833,18 +3449,38 @@ auto Enumerable<T>::GroupJoinLess(
         TOuterKeySelector outerKeySelector,
         TInnerKeySelector innerKeySelector,
         TResultSelector resultSelector) && -> Enumerable<std::invoke_result_t<TResultSelector, reference, const Enumerable<std::decay_t<decltype(*std::begin(inner))>>&>> {
-    std::multimap<std::invoke_result_t<TOuterKeySelector, reference>, std::pair<value_type, std::vector<std::decay_t<decltype(*std::begin(inner))>>>, TLess> values{};
+    using Key = std::invoke_result_t<TOuterKeySelector, reference>;
+    using Inner = std::decay_t<decltype(*std::begin(inner))>;
+    detail::MemoryCharge charge{"GroupJoin"};
+    std::map<Key, size_type, TLess> indices{};
+    std::vector<value_type> outers{};
+    std::vector<size_type> outerGroups{};
+    size_type usage = 0;
     for (auto i = std::move(*this).begin(), j = end(); i != j; ++i) {
         auto&& source = *i;
-        values.insert({outerKeySelector(source), {source, {}}});
+        auto [itr, inserted] = indices.try_emplace(outerKeySelector(source), std::size(indices));
+        outers.emplace_back(source);
+        outerGroups.push_back(itr->second);
+        usage += sizeof(value_type) + sizeof(size_type) + (inserted ? sizeof(typename decltype(indices)::value_type) + sizeof(Enumerable<Inner>) : 0);
+        charge.Update(usage);
     }
+    std::vector<Inner> rows{};
+    std::vector<size_type> groups{};
     for (auto&& element : inner) {
-        for (auto&& [i, j] = values.equal_range(innerKeySelector(element)); i != j; ++i) {
-            i->second.second.emplace_back(element);
+        if (auto itr = indices.find(innerKeySelector(element)); itr != std::end(indices)) {
+            groups.push_back(itr->second);
+            rows.emplace_back(element);
+            usage += sizeof(Inner) + sizeof(size_type);
+            charge.Update(usage);
         }
     }
-    for (auto&& value : values) {
-        co_yield resultSelector(value.second.first, value.second.second);
+    auto views = Enumerable<Inner>::Views(std::move(rows), std::move(groups), std::size(indices));
+    // Results are ordered by key and then by the original order of the outer elements.
+    auto offsets = detail::GroupContiguously(outers, std::move(outerGroups), std::size(indices));
+    for (auto&& [_, group] : indices) {
+        for (auto i = offsets[group]; i < offsets[group + 1]; ++i) {
+            co_yield resultSelector(outers[i], views[group]);
+        }
     }
 }
 
@@ -886,22 +3522,41 @@ auto Enumerable<T>::GroupJoinEqual(
         TOuterKeySelector outerKeySelector,
         TInnerKeySelector innerKeySelector,
         TResultSelector resultSelector) && -> Enumerable<std::invoke_result_t<TResultSelector, reference, const Enumerable<std::decay_t<decltype(*std::begin(inner))>>&>> {
-    std::vector<std::pair<std::invoke_result_t<TOuterKeySelector, reference>, std::pair<value_type, std::vector<std::decay_t<decltype(*std::begin(inner))>>>>> values{};
+    using Key = std::invoke_result_t<TOuterKeySelector, reference>;
+    using Inner = std::decay_t<decltype(*std::begin(inner))>;
+    detail::MemoryCharge charge{"GroupJoin"};
+    std::vector<Key> keys{};
+    std::vector<value_type> outers{};
+    std::vector<size_type> outerGroups{};
     TEqual equal{};
+    size_type usage = 0;
     for (auto i = std::move(*this).begin(), j = end(); i != j; ++i) {
         auto&& source = *i;
-        values.push_back({outerKeySelector(source), {source, {}}});
+        auto key = outerKeySelector(source);
+        auto itr = std::find_if(std::begin(keys), std::end(keys), [&] (auto&& value) { return equal(value, key); });
+        outerGroups.push_back(itr - std::begin(keys));
+        if (itr == std::end(keys)) {
+            keys.push_back(std::move(key));
+            usage += sizeof(Key) + sizeof(Enumerable<Inner>);
+        }
+        outers.emplace_back(source);
+        usage += sizeof(value_type) + sizeof(size_type);
+        charge.Update(usage);
     }
+    std::vector<Inner> rows{};
+    std::vector<size_type> groups{};
     for (auto&& element : inner) {
         auto innerKey = innerKeySelector(element);
-        for (auto&& value : values) {
-            if (equal(innerKey, value.first)) {
-                value.second.second.emplace_back(element);
-            }
+        if (auto itr = std::find_if(std::begin(keys), std::end(keys), [&] (auto&& key) { return equal(innerKey, key); }); itr != std::end(keys)) {
+            groups.push_back(itr - std::begin(keys));
+            rows.emplace_back(element);
+            usage += sizeof(Inner) + sizeof(size_type);
+            charge.Update(usage);
         }
     }
-    for (auto&& value : values) {
-        co_yield resultSelector(value.second.first, value.second.second);
+    auto views = Enumerable<Inner>::Views(std::move(rows), std::move(groups), std::size(keys));
+    for (size_type i = 0; i < std::size(outers); ++i) {
+        co_yield resultSelector(outers[i], views[outerGroups[i]]);
     }
 }
 
@@ -936,6 +3591,31 @@ auto Enumerable<T>::GroupJoinEqual(
     return GroupJoinEqual<TEqual, std::initializer_list<U>>(inner, outerKeySelector, innerKeySelector, resultSelector);
 }
 
+template<class T>
+template<class TLess, class TInner, class TOuterKeySelector, class TInnerKeySelector, class TResultSelector>
+auto Enumerable<T>::GroupJoinSorted(
+        Enumerable<TInner> inner,
+        TOuterKeySelector outerKeySelector,
+        TInnerKeySelector innerKeySelector,
+        TResultSelector resultSelector) && -> Enumerable<std::invoke_result_t<TResultSelector, reference, const Enumerable<TInner>&>> {
+    detail::SortedRuns<TInner, TInnerKeySelector, TLess> runs{std::move(inner), std::move(innerKeySelector), "GroupJoin"};
+    for (auto i = std::move(*this).begin(), j = end(); i != j; ++i) {
+        auto&& source = *i;
+        co_yield resultSelector(source, runs.Find(outerKeySelector(source)));
+    }
+}
+
+template<class T>
+template<class TLess, class TInner, class TOuterKeySelector, class TInnerKeySelector, class TResultSelector>
+auto Enumerable<T>::GroupJoinSorted(
+        Enumerable<TInner> inner,
+        TOuterKeySelector outerKeySelector,
+        TInnerKeySelector innerKeySelector,
+        TResultSelector resultSelector) const & -> Enumerable<std::invoke_result_t<TResultSelector, reference, const Enumerable<TInner>&>> {
+    controller_.Flush();
+    return std::move(*const_cast<Enumerable*>(this)).template GroupJoinSorted<TLess>(std::move(inner), outerKeySelector, innerKeySelector, resultSelector);
+}
+
 template<class T>
 template<class TEnumerable, class TOuterKeySelector, class TInnerKeySelector, class TResultSelector>
 auto Enumerable<T>::GroupJoin(
@@ -944,8 +3624,16 @@ auto Enumerable<T>::GroupJoin(
         TInnerKeySelector innerKeySelector,
         TResultSelector resultSelector) && -> Enumerable<std::invoke_result_t<TResultSelector, reference, const Enumerable<std::decay_t<decltype(*std::begin(inner))>>&>> {
     using Key = std::invoke_result_t<TOuterKeySelector, reference>;
+    if constexpr (detail::is_enumerable_v<TEnumerable> && detail::is_default_lessable_v<Key>) {
+        using InnerKey = std::invoke_result_t<TInnerKeySelector, decltype(*std::begin(inner))>;
+        if constexpr (std::is_same_v<Key, InnerKey>) {
+            if (IsOrderedBy<TOuterKeySelector, std::less<Key>>() && inner.template IsOrderedBy<TInnerKeySelector, std::less<Key>>()) {
+                return std::move(*this).template GroupJoinSorted<std::less<Key>>(inner, outerKeySelector, innerKeySelector, resultSelector);
+            }
+        }
+    }
     if constexpr (detail::is_default_hashable_v<Key>) {
-        return std::move(*this).template GroupJoinHash<std::hash<Key>>(inner, outerKeySelector, innerKeySelector, resultSelector);
+        return std::move(*this).template GroupJoinHash<Hash<Key>>(inner, outerKeySelector, innerKeySelector, resultSelector);
     } else if constexpr (detail::is_default_lessable_v<Key>) {
         return std::move(*this).template GroupJoinLess<std::less<Key>>(inner, outerKeySelector, innerKeySelector, resultSelector);
     } else if constexpr (detail::is_default_equalable_v<Key>) {
@@ -986,14 +3674,49 @@ auto Enumerable<T>::GroupJoin(
     return GroupJoin<std::initializer_list<U>>(inner, outerKeySelector, innerKeySelector, resultSelector);
 }
 
+template<class T>
+template<class TKey, class TInner, class THash, class TOuterKeySelector, class TResultSelector>
+auto Enumerable<T>::GroupJoin(
+        Lookup<TKey, TInner, THash> inner,
+        TOuterKeySelector outerKeySelector,
+        TResultSelector resultSelector) && -> Enumerable<std::invoke_result_t<TResultSelector, reference, const Enumerable<TInner>&>> {
+    for (auto i = std::move(*this).begin(), j = end(); i != j; ++i) {
+        auto&& source = *i;
+        // The group is viewed where the Lookup keeps it, so no element is copied.
+        auto group = inner.Share(outerKeySelector(source));
+        auto size = std::size(*group);
+        co_yield resultSelector(source, Enumerable<TInner>::View(std::move(group), 0, size));
+    }
+}
+
+template<class T>
+template<class TKey, class TInner, class THash, class TOuterKeySelector, class TResultSelector>
+auto Enumerable<T>::GroupJoin(
+        Lookup<TKey, TInner, THash> inner,
+        TOuterKeySelector outerKeySelector,
+        TResultSelector resultSelector) const & -> Enumerable<std::invoke_result_t<TResultSelector, reference, const Enumerable<TInner>&>> {
+    controller_.Flush();
+    return std::move(*const_cast<Enumerable*>(this)).GroupJoin(std::move(inner), outerKeySelector, resultSelector);
+}
+
 template<class T>
 template<class THash>
 auto Enumerable<T>::IntersectHash(const Enumerable& other) && -> Enumerable {
-    std::unordered_set<value_type, THash> values{std::begin(other), std::end(other)};
-    for (auto i = std::move(*this).template DistinctHash<THash>().begin(), j = end(); i != j; ++i) {
-        auto&& source = *i;
-        if (values.find(source) != values.end()) {
-            co_yield source;
+    detail::KeyIndex<value_type, THash> values{};
+    for (auto&& value : other) {
+        values.Insert(value);
+    }
+    auto filter = detail::KeyFilter(values);
+    detail::MemoryCharge charge{"Intersect"};
+    charge.Update(values.Bytes() + (filter ? filter->Bytes() : 0));
+    // Elements are remembered by the number of their value in other, so only matches take up room.
+    std::vector<bool> seen(values.Size());
+    auto probes = std::move(*this).Probe(values, std::identity{}, filter);
+    for (auto i = std::move(probes).begin(), j = probes.end(); i != j; ++i) {
+        auto&& [source, found] = *i;
+        if (found && !seen[*found]) {
+            seen[*found] = true;
+            co_yield *source;
         }
     }
 }
@@ -1009,6 +3732,8 @@ template<class T>
 template<class TLess>
 auto Enumerable<T>::IntersectLess(const Enumerable& other) && -> Enumerable {
     std::set<value_type, TLess> values{std::begin(other), std::end(other)};
+    detail::MemoryCharge charge{"Intersect"};
+    charge.Update(std::size(values) * sizeof(value_type));
     for (auto i = std::move(*this).template DistinctLess<TLess>().begin(), j = end(); i != j; ++i) {
         auto&& source = *i;
         if (values.find(source) != values.end()) {
@@ -1028,6 +3753,8 @@ template<class T>
 template<class TEqual>
 auto Enumerable<T>::IntersectEqual(const Enumerable& other) && -> Enumerable {
     std::vector<value_type> values{std::begin(other), std::end(other)};
+    detail::MemoryCharge charge{"Intersect"};
+    charge.Update(std::size(values) * sizeof(value_type));
     TEqual equal{};
     for (auto i = std::move(*this).template DistinctEqual<TEqual>().begin(), j = end(); i != j; ++i) {
         auto&& source = *i;
@@ -1044,10 +3771,68 @@ auto Enumerable<T>::IntersectEqual(const Enumerable& other) const & -> Enumerabl
     return std::move(*const_cast<Enumerable*>(this)).template IntersectEqual<TEqual>(other);
 }
 
+template<class T>
+auto Enumerable<T>::IntersectBitmap(Enumerable other) && -> Enumerable {
+    auto combined = std::move(*this).CombineBitmaps(std::move(other), [] (detail::Bitmap& lhs, const detail::Bitmap& rhs) { lhs &= rhs; }, "Intersect");
+    return Enumerable{std::move(combined.controller_), detail::OrderTag<std::identity, std::less<value_type>>()};
+}
+
+template<class T>
+auto Enumerable<T>::IntersectBitmap(Enumerable other) const & -> Enumerable {
+    controller_.Flush();
+    return std::move(*const_cast<Enumerable*>(this)).IntersectBitmap(std::move(other));
+}
+
+template<class T>
+template<class TLess>
+auto Enumerable<T>::IntersectSorted(Enumerable other) && -> Enumerable {
+    auto merged = std::move(*this).template IntersectSortedImpl<TLess>(std::move(other));
+    return Enumerable{std::move(merged.controller_), detail::OrderTag<std::identity, TLess>()};
+}
+
+template<class T>
+template<class TLess>
+auto Enumerable<T>::IntersectSorted(Enumerable other) const & -> Enumerable {
+    controller_.Flush();
+    return std::move(*const_cast<Enumerable*>(this)).template IntersectSorted<TLess>(std::move(other));
+}
+
+template<class T>
+template<class TLess>
+auto Enumerable<T>::IntersectSortedImpl(Enumerable other) && -> Enumerable {
+    TLess less{};
+    std::optional<value_type> last{};
+    auto i = std::move(*this).begin();
+    auto j = std::move(other).begin();
+    for (auto k = end(); (i != k) && (j != k);) {
+        if (less(*i, *j)) {
+            ++i;
+        } else if (less(*j, *i)) {
+            ++j;
+        } else {
+            if (!last || less(*last, *i)) {
+                last = *i;
+                co_yield *last;
+            }
+            ++i;
+        }
+    }
+}
+
 template<class T>
 auto Enumerable<T>::Intersect(const Enumerable& other) && -> Enumerable {
+    if constexpr (detail::is_default_lessable_v<value_type>) {
+        if (IsOrderedBy<std::identity, std::less<value_type>>() && other.IsOrderedBy<std::identity, std::less<value_type>>()) {
+            return std::move(*this).template IntersectSorted<std::less<value_type>>(other);
+        }
+    }
+    if constexpr (requires (const value_type& value) { value > value; }) {
+        if (IsOrderedBy<std::identity, std::greater<value_type>>() && other.IsOrderedBy<std::identity, std::greater<value_type>>()) {
+            return std::move(*this).template IntersectSorted<std::greater<value_type>>(other);
+        }
+    }
     if constexpr (detail::is_default_hashable_v<value_type>) {
-        return std::move(*this).template IntersectHash<std::hash<value_type>>(other);
+        return std::move(*this).template IntersectHash<Hash<value_type>>(other);
     } else if constexpr (detail::is_default_lessable_v<value_type>) {
         return std::move(*this).template IntersectLess<std::less<value_type>>(other);
     } else if constexpr (detail::is_default_equalable_v<value_type>) {
@@ -1063,6 +3848,75 @@ auto Enumerable<T>::Intersect(const Enumerable& other) const & -> Enumerable {
     return std::move(*const_cast<Enumerable*>(this)).Intersect(other);
 }
 
+template<class T>
+template<class TLess, class TEnumerable, class TStartSelector, class TEndSelector, class TInnerTimeSelector, class TResultSelector>
+auto Enumerable<T>::IntervalJoin(
+        const TEnumerable& inner,
+        TStartSelector startSelector,
+        TEndSelector endSelector,
+        TInnerTimeSelector innerTimeSelector,
+        TResultSelector resultSelector) && -> Enumerable<std::invoke_result_t<TResultSelector, reference, decltype(*std::begin(inner))>> {
+    using Inner = std::decay_t<decltype(*std::begin(inner))>;
+    TLess less{};
+    std::vector<Inner> points(std::begin(inner), std::end(inner));
+    detail::MemoryCharge charge{"IntervalJoin"};
+    charge.Update(points.capacity() * sizeof(Inner));
+    std::stable_sort(std::begin(points), std::end(points), [&] (const Inner& lhs, const Inner& rhs) {
+        return less(innerTimeSelector(lhs), innerTimeSelector(rhs));
+    });
+    for (auto i = std::move(*this).begin(), j = end(); i != j; ++i) {
+        auto&& source = *i;
+        auto&& startTime = startSelector(source);
+        auto&& endTime = endSelector(source);
+        auto point = std::partition_point(std::begin(points), std::end(points), [&] (const Inner& element) {
+            return less(innerTimeSelector(element), startTime);
+        });
+        for (; (point != std::end(points)) && less(innerTimeSelector(*point), endTime); ++point) {
+            co_yield resultSelector(source, *point);
+        }
+    }
+}
+
+template<class T>
+template<class TLess, class U, class TStartSelector, class TEndSelector, class TInnerTimeSelector, class TResultSelector>
+auto Enumerable<T>::IntervalJoin(
+        std::initializer_list<U> inner,
+        TStartSelector startSelector,
+        TEndSelector endSelector,
+        TInnerTimeSelector innerTimeSelector,
+        TResultSelector resultSelector) && -> Enumerable<std::invoke_result_t<TResultSelector, reference, const U&>> {
+    return std::move(*this).template IntervalJoin<TLess, std::initializer_list<U>>(inner, startSelector, endSelector, innerTimeSelector, resultSelector);
+}
+
+template<class T>
+template<class TLess, class TEnumerable, class TStartSelector, class TEndSelector, class TInnerTimeSelector, class TResultSelector>
+auto Enumerable<T>::IntervalJoin(
+        const TEnumerable& inner,
+        TStartSelector startSelector,
+        TEndSelector endSelector,
+        TInnerTimeSelector innerTimeSelector,
+        TResultSelector resultSelector) const & -> Enumerable<std::invoke_result_t<TResultSelector, reference, decltype(*std::begin(inner))>> {
+    controller_.Flush();
+    return std::move(*const_cast<Enumerable*>(this)).template IntervalJoin<TLess>(inner, startSelector, endSelector, innerTimeSelector, resultSelector);
+}
+
+template<class T>
+template<class TLess, class U, class TStartSelector, class TEndSelector, class TInnerTimeSelector, class TResultSelector>
+auto Enumerable<T>::IntervalJoin(
+        std::initializer_list<U> inner,
+        TStartSelector startSelector,
+        TEndSelector endSelector,
+        TInnerTimeSelector innerTimeSelector,
+        TResultSelector resultSelector) const & -> Enumerable<std::invoke_result_t<TResultSelector, reference, const U&>> {
+    return IntervalJoin<TLess, std::initializer_list<U>>(inner, startSelector, endSelector, innerTimeSelector, resultSelector);
+}
+
+template<class T>
+template<class TKeySelector, class TComparer>
+bool Enumerable<T>::IsOrderedBy() const noexcept {
+    return detail::IsSameOrder(orderedBy_, detail::OrderTag<TKeySelector, TComparer>());
+}
+
 template<class T>
 template<class THash, class TEnumerable, class TOuterKeySelector, class TInnerKeySelector, class TResultSelector>
 auto Enumerable<T>::JoinHash(
@@ -1070,18 +3924,106 @@ auto Enumerable<T>::JoinHash(
         TOuterKeySelector outerKeySelector,
         TInnerKeySelector innerKeySelector,
         TResultSelector resultSelector) && -> Enumerable<std::invoke_result_t<TResultSelector, reference, decltype(*std::begin(inner))>> {
-    auto values = std::accumulate(
-        std::begin(inner),
-        std::end(inner),
-        std::unordered_multimap<std::invoke_result_t<TInnerKeySelector, decltype(*std::begin(inner))>, std::decay_t<decltype(*std::begin(inner))>, THash>{},
-        [&] (auto&& acc, auto&& val) {
-            acc.insert({innerKeySelector(val), val});
-            return std::move(acc);
-        });
+    return std::move(*this).template JoinHash<THash>(inner, outerKeySelector, innerKeySelector, resultSelector, BuildSide::Auto);
+}
+
+template<class T>
+template<class THash, class U, class TOuterKeySelector, class TInnerKeySelector, class TResultSelector>
+auto Enumerable<T>::JoinHash(
+        std::initializer_list<U> inner,
+        TOuterKeySelector outerKeySelector,
+        TInnerKeySelector innerKeySelector,
+        TResultSelector resultSelector) && -> Enumerable<std::invoke_result_t<TResultSelector, reference, const U&>> {
+    return std::move(*this).template JoinHash<THash, std::initializer_list<U>>(inner, outerKeySelector, innerKeySelector, resultSelector);
+}
+
+template<class T>
+template<class THash, class TEnumerable, class TOuterKeySelector, class TInnerKeySelector, class TResultSelector>
+auto Enumerable<T>::JoinHash(
+        const TEnumerable& inner,
+        TOuterKeySelector outerKeySelector,
+        TInnerKeySelector innerKeySelector,
+        TResultSelector resultSelector) const & -> Enumerable<std::invoke_result_t<TResultSelector, reference, decltype(*std::begin(inner))>> {
+    controller_.Flush();
+    return std::move(*const_cast<Enumerable*>(this)).template JoinHash<THash>(inner, outerKeySelector, innerKeySelector, resultSelector);
+}
+
+template<class T>
+template<class THash, class U, class TOuterKeySelector, class TInnerKeySelector, class TResultSelector>
+auto Enumerable<T>::JoinHash(
+        std::initializer_list<U> inner,
+        TOuterKeySelector outerKeySelector,
+        TInnerKeySelector innerKeySelector,
+        TResultSelector resultSelector) const & -> Enumerable<std::invoke_result_t<TResultSelector, reference, const U&>> {
+    return JoinHash<THash, std::initializer_list<U>>(inner, outerKeySelector, innerKeySelector, resultSelector);
+}
+
+template<class T>
+template<class THash, class TEnumerable, class TOuterKeySelector, class TInnerKeySelector, class TResultSelector>
+auto Enumerable<T>::JoinHash(
+        const TEnumerable& inner,
+        TOuterKeySelector outerKeySelector,
+        TInnerKeySelector innerKeySelector,
+        TResultSelector resultSelector,
+        BuildSide side) && -> Enumerable<std::invoke_result_t<TResultSelector, reference, decltype(*std::begin(inner))>> {
+    using Inner = std::decay_t<decltype(*std::begin(inner))>;
+    using Key = std::decay_t<std::invoke_result_t<TInnerKeySelector, decltype(*std::begin(inner))>>;
+    detail::MemoryCharge charge{"Join"};
+    size_type usage = 0;
+    if (ChooseBuildSide(inner, side) == BuildSide::Inner) {
+        // Inner elements are laid out by key, so that the matches of a key are contiguous.
+        detail::KeyIndex<Key, THash> indices{};
+        std::vector<Inner> rows{};
+        std::vector<size_type> groups{};
+        for (auto&& element : inner) {
+            groups.push_back(indices.Insert(innerKeySelector(element)).first);
+            rows.emplace_back(element);
+            usage += sizeof(Inner) + sizeof(size_type);
+            charge.Update(indices.Bytes() + usage);
+        }
+        auto offsets = detail::GroupContiguously(rows, std::move(groups), indices.Size());
+        // Most outer elements of a selective join match nothing, and the filter turns them away without probing the table.
+        auto filter = detail::KeyFilter(indices);
+        charge.Update(indices.Bytes() + (usage += filter ? filter->Bytes() : 0));
+        auto probes = std::move(*this).Probe(indices, outerKeySelector, filter);
+        for (auto i = std::move(probes).begin(), j = probes.end(); i != j; ++i) {
+            auto&& [source, group] = *i;
+            if (group) {
+                for (auto k = offsets[*group]; k < offsets[*group + 1]; ++k) {
+                    co_yield resultSelector(*source, rows[k]);
+                }
+            }
+        }
+        co_return;
+    }
+
+    std::unordered_map<Key, std::vector<Inner>, THash, std::equal_to<>> matches{};
+    // Outer elements are kept in their original order, each pointing at the matches of its key, so that inner elements only need to be
+    // kept if they match.
+    std::vector<std::pair<value_type, const std::vector<Inner>*>> outers{};
     for (auto i = std::move(*this).begin(), j = end(); i != j; ++i) {
         auto&& source = *i;
-        for (auto&& [l, r] = values.equal_range(outerKeySelector(source)); l != r; ++l) {
-            co_yield resultSelector(source, l->second);
+        auto [itr, inserted] = matches.try_emplace(outerKeySelector(source));
+        outers.emplace_back(source, &itr->second);
+        usage += sizeof(typename decltype(outers)::value_type) + (inserted ? sizeof(typename decltype(matches)::value_type) : 0);
+        charge.Update(usage);
+    }
+    auto filter = detail::KeyFilter(matches);
+    charge.Update(usage += filter ? filter->Bytes() : 0);
+    for (auto&& element : inner) {
+        auto&& key = innerKeySelector(element);
+        if (filter && !filter->MayContain(matches.hash_function()(key))) {
+            continue;
+        }
+        if (auto itr = matches.find(key); itr != std::end(matches)) {
+            itr->second.emplace_back(element);
+            usage += sizeof(Inner);
+            charge.Update(usage);
+        }
+    }
+    for (auto&& [source, elements] : outers) {
+        for (auto&& element : *elements) {
+            co_yield resultSelector(source, element);
         }
     }
 }
@@ -1092,29 +4034,116 @@ auto Enumerable<T>::JoinHash(
         std::initializer_list<U> inner,
         TOuterKeySelector outerKeySelector,
         TInnerKeySelector innerKeySelector,
-        TResultSelector resultSelector) && -> Enumerable<std::invoke_result_t<TResultSelector, reference, const U&>> {
-    return std::move(*this).template JoinHash<THash, std::initializer_list<U>>(inner, outerKeySelector, innerKeySelector, resultSelector);
+        TResultSelector resultSelector,
+        BuildSide side) && -> Enumerable<std::invoke_result_t<TResultSelector, reference, const U&>> {
+    return std::move(*this).template JoinHash<THash, std::initializer_list<U>>(inner, outerKeySelector, innerKeySelector, resultSelector, side);
+}
+
+template<class T>
+template<class THash, class TEnumerable, class TOuterKeySelector, class TInnerKeySelector, class TResultSelector>
+auto Enumerable<T>::JoinHash(
+        const TEnumerable& inner,
+        TOuterKeySelector outerKeySelector,
+        TInnerKeySelector innerKeySelector,
+        TResultSelector resultSelector,
+        BuildSide side) const & -> Enumerable<std::invoke_result_t<TResultSelector, reference, decltype(*std::begin(inner))>> {
+    controller_.Flush();
+    return std::move(*const_cast<Enumerable*>(this)).template JoinHash<THash>(inner, outerKeySelector, innerKeySelector, resultSelector, side);
+}
+
+template<class T>
+template<class THash, class U, class TOuterKeySelector, class TInnerKeySelector, class TResultSelector>
+auto Enumerable<T>::JoinHash(
+        std::initializer_list<U> inner,
+        TOuterKeySelector outerKeySelector,
+        TInnerKeySelector innerKeySelector,
+        TResultSelector resultSelector,
+        BuildSide side) const & -> Enumerable<std::invoke_result_t<TResultSelector, reference, const U&>> {
+    return JoinHash<THash, std::initializer_list<U>>(inner, outerKeySelector, innerKeySelector, resultSelector, side);
+}
+
+template<class T>
+template<class THash, class TSerializer, class TInnerSerializer, class TEnumerable, class TOuterKeySelector, class TInnerKeySelector, class TResultSelector>
+auto Enumerable<T>::JoinHash(
+        const TEnumerable& inner,
+        TOuterKeySelector outerKeySelector,
+        TInnerKeySelector innerKeySelector,
+        TResultSelector resultSelector,
+        size_type memoryBudget) && -> Enumerable<std::invoke_result_t<TResultSelector, reference, decltype(*std::begin(inner))>> {
+    using Inner = std::decay_t<decltype(*std::begin(inner))>;
+    using InnerSerializer = std::conditional_t<std::is_void_v<TInnerSerializer>, Serializer<Inner>, TInnerSerializer>;
+    return std::move(*this).template JoinHashImpl<THash, TSerializer, InnerSerializer>(
+        detail::Stream<Inner>(inner),
+        outerKeySelector,
+        innerKeySelector,
+        resultSelector,
+        detail::GovernedBudget(memoryBudget),
+        0);
 }
 
 template<class T>
-template<class THash, class TEnumerable, class TOuterKeySelector, class TInnerKeySelector, class TResultSelector>
+template<class THash, class TSerializer, class TInnerSerializer, class TEnumerable, class TOuterKeySelector, class TInnerKeySelector, class TResultSelector>
 auto Enumerable<T>::JoinHash(
         const TEnumerable& inner,
         TOuterKeySelector outerKeySelector,
         TInnerKeySelector innerKeySelector,
-        TResultSelector resultSelector) const & -> Enumerable<std::invoke_result_t<TResultSelector, reference, decltype(*std::begin(inner))>> {
+        TResultSelector resultSelector,
+        size_type memoryBudget) const & -> Enumerable<std::invoke_result_t<TResultSelector, reference, decltype(*std::begin(inner))>> {
     controller_.Flush();
-    return std::move(*const_cast<Enumerable*>(this)).template JoinHash<THash>(inner, outerKeySelector, innerKeySelector, resultSelector);
+    return std::move(*const_cast<Enumerable*>(this)).template JoinHash<THash, TSerializer, TInnerSerializer>(inner, outerKeySelector, innerKeySelector, resultSelector, memoryBudget);
 }
 
+// Hybrid hash join: outer elements whose partition stayed in memory are joined in order; the others are spilled next to their inner
+// partition and each such pair is joined one level deeper.
 template<class T>
-template<class THash, class U, class TOuterKeySelector, class TInnerKeySelector, class TResultSelector>
-auto Enumerable<T>::JoinHash(
-        std::initializer_list<U> inner,
+template<class THash, class TSerializer, class TInnerSerializer, class TInner, class TOuterKeySelector, class TInnerKeySelector, class TResultSelector>
+auto Enumerable<T>::JoinHashImpl(
+        Enumerable<TInner> inner,
         TOuterKeySelector outerKeySelector,
         TInnerKeySelector innerKeySelector,
-        TResultSelector resultSelector) const & -> Enumerable<std::invoke_result_t<TResultSelector, reference, const U&>> {
-    return JoinHash<THash, std::initializer_list<U>>(inner, outerKeySelector, innerKeySelector, resultSelector);
+        TResultSelector resultSelector,
+        size_type memoryBudget,
+        std::size_t depth) && -> Enumerable<std::invoke_result_t<TResultSelector, reference, const TInner&>> {
+    detail::SpillingMultimap<std::invoke_result_t<TInnerKeySelector, const TInner&>, TInner, THash, TInnerSerializer> values{memoryBudget, depth, "Join"};
+    for (auto i = std::move(inner).begin(), j = inner.end(); i != j; ++i) {
+        auto&& element = *i;
+        values.Insert(innerKeySelector(element), element);
+    }
+
+    std::vector<std::optional<detail::TemporaryFile>> outers(detail::kSpillPartitions);
+    for (auto i = std::move(*this).begin(), j = end(); i != j; ++i) {
+        auto&& source = *i;
+        auto key = outerKeySelector(source);
+        if (auto partition = values.PartitionOf(key); values.IsSpilled(partition)) {
+            if (!outers[partition]) {
+                outers[partition].emplace();
+            }
+            TSerializer::Write(outers[partition]->Get(), source);
+            continue;
+        }
+        for (auto&& [l, r] = values.EqualRange(key); l != r; ++l) {
+            co_yield resultSelector(source, l->second);
+        }
+    }
+
+    auto inners = values.Release();
+    for (std::size_t partition = 0; partition < detail::kSpillPartitions; ++partition) {
+        if (!outers[partition]) {
+            continue;
+        }
+        auto joined = detail::ReadSpilled<value_type, TSerializer>(std::move(*outers[partition]))
+            .template JoinHashImpl<THash, TSerializer, TInnerSerializer>(
+                detail::ReadSpilled<TInner, TInnerSerializer>(std::move(*inners[partition])),
+                outerKeySelector,
+                innerKeySelector,
+                resultSelector,
+                memoryBudget,
+                depth + 1);
+        for (auto i = std::move(joined).begin(), j = joined.end(); i != j; ++i) {
+            auto&& result = *i;
+            co_yield result;
+        }
+    }
 }
 
 template<class T>
@@ -1124,12 +4153,14 @@ auto Enumerable<T>::JoinLess(
         TOuterKeySelector outerKeySelector,
         TInnerKeySelector innerKeySelector,
         TResultSelector resultSelector) && -> Enumerable<std::invoke_result_t<TResultSelector, reference, decltype(*std::begin(inner))>> {
+    detail::MemoryCharge charge{"Join"};
     auto values = std::accumulate(
         std::begin(inner),
         std::end(inner),
         std::multimap<std::invoke_result_t<TInnerKeySelector, decltype(*std::begin(inner))>, std::decay_t<decltype(*std::begin(inner))>, TLess>{},
         [&] (auto&& acc, auto&& val) {
             acc.insert({innerKeySelector(val), val});
+            charge.Update(std::size(acc) * sizeof(typename std::decay_t<decltype(acc)>::value_type));
             return std::move(acc);
         });
     for (auto i = std::move(*this).begin(), j = end(); i != j; ++i) {
@@ -1178,12 +4209,14 @@ auto Enumerable<T>::JoinEqual(
         TOuterKeySelector outerKeySelector,
         TInnerKeySelector innerKeySelector,
         TResultSelector resultSelector) && -> Enumerable<std::invoke_result_t<TResultSelector, reference, decltype(*std::begin(inner))>> {
+    detail::MemoryCharge charge{"Join"};
     auto values = std::accumulate(
         std::begin(inner),
         std::end(inner),
         std::vector<std::pair<std::invoke_result_t<TInnerKeySelector, decltype(*std::begin(inner))>, std::decay_t<decltype(*std::begin(inner))>>>{},
         [&] (auto&& acc, auto&& val) {
             acc.push_back({innerKeySelector(val), val});
+            charge.Update(acc.capacity() * sizeof(typename std::decay_t<decltype(acc)>::value_type));
             return std::move(acc);
         });
     TEqual equal{};
@@ -1228,6 +4261,33 @@ auto Enumerable<T>::JoinEqual(
     return JoinEqual<TEqual, std::initializer_list<U>>(inner, outerKeySelector, innerKeySelector, resultSelector);
 }
 
+template<class T>
+template<class TLess, class TInner, class TOuterKeySelector, class TInnerKeySelector, class TResultSelector>
+auto Enumerable<T>::JoinSorted(
+        Enumerable<TInner> inner,
+        TOuterKeySelector outerKeySelector,
+        TInnerKeySelector innerKeySelector,
+        TResultSelector resultSelector) && -> Enumerable<std::invoke_result_t<TResultSelector, reference, const TInner&>> {
+    detail::SortedRuns<TInner, TInnerKeySelector, TLess> runs{std::move(inner), std::move(innerKeySelector), "Join"};
+    for (auto i = std::move(*this).begin(), j = end(); i != j; ++i) {
+        auto&& source = *i;
+        for (auto&& element : runs.Find(outerKeySelector(source))) {
+            co_yield resultSelector(source, element);
+        }
+    }
+}
+
+template<class T>
+template<class TLess, class TInner, class TOuterKeySelector, class TInnerKeySelector, class TResultSelector>
+auto Enumerable<T>::JoinSorted(
+        Enumerable<TInner> inner,
+        TOuterKeySelector outerKeySelector,
+        TInnerKeySelector innerKeySelector,
+        TResultSelector resultSelector) const & -> Enumerable<std::invoke_result_t<TResultSelector, reference, const TInner&>> {
+    controller_.Flush();
+    return std::move(*const_cast<Enumerable*>(this)).template JoinSorted<TLess>(std::move(inner), outerKeySelector, innerKeySelector, resultSelector);
+}
+
 template<class T>
 template<class TEnumerable, class TOuterKeySelector, class TInnerKeySelector, class TResultSelector>
 auto Enumerable<T>::Join(
@@ -1236,8 +4296,16 @@ auto Enumerable<T>::Join(
         TInnerKeySelector innerKeySelector,
         TResultSelector resultSelector) && -> Enumerable<std::invoke_result_t<TResultSelector, reference, decltype(*std::begin(inner))>> {
     using Key = std::invoke_result_t<TOuterKeySelector, reference>;
+    if constexpr (detail::is_enumerable_v<TEnumerable> && detail::is_default_lessable_v<Key>) {
+        using InnerKey = std::invoke_result_t<TInnerKeySelector, decltype(*std::begin(inner))>;
+        if constexpr (std::is_same_v<Key, InnerKey>) {
+            if (IsOrderedBy<TOuterKeySelector, std::less<Key>>() && inner.template IsOrderedBy<TInnerKeySelector, std::less<Key>>()) {
+                return std::move(*this).template JoinSorted<std::less<Key>>(inner, outerKeySelector, innerKeySelector, resultSelector);
+            }
+        }
+    }
     if constexpr (detail::is_default_hashable_v<Key>) {
-        return std::move(*this).template JoinHash<std::hash<Key>>(inner, outerKeySelector, innerKeySelector, resultSelector);
+        return std::move(*this).template JoinHash<Hash<Key>>(inner, outerKeySelector, innerKeySelector, resultSelector);
     } else if constexpr (detail::is_default_lessable_v<Key>) {
         return std::move(*this).template JoinLess<std::less<Key>>(inner, outerKeySelector, innerKeySelector, resultSelector);
     } else if constexpr (detail::is_default_equalable_v<Key>) {
@@ -1278,6 +4346,30 @@ auto Enumerable<T>::Join(
     return Join<std::initializer_list<U>>(inner, outerKeySelector, innerKeySelector, resultSelector);
 }
 
+template<class T>
+template<class TKey, class TInner, class THash, class TOuterKeySelector, class TResultSelector>
+auto Enumerable<T>::Join(
+        Lookup<TKey, TInner, THash> inner,
+        TOuterKeySelector outerKeySelector,
+        TResultSelector resultSelector) && -> Enumerable<std::invoke_result_t<TResultSelector, reference, const TInner&>> {
+    for (auto i = std::move(*this).begin(), j = end(); i != j; ++i) {
+        auto&& source = *i;
+        for (auto&& element : inner[outerKeySelector(source)]) {
+            co_yield resultSelector(source, element);
+        }
+    }
+}
+
+template<class T>
+template<class TKey, class TInner, class THash, class TOuterKeySelector, class TResultSelector>
+auto Enumerable<T>::Join(
+        Lookup<TKey, TInner, THash> inner,
+        TOuterKeySelector outerKeySelector,
+        TResultSelector resultSelector) const & -> Enumerable<std::invoke_result_t<TResultSelector, reference, const TInner&>> {
+    controller_.Flush();
+    return std::move(*const_cast<Enumerable*>(this)).Join(std::move(inner), outerKeySelector, resultSelector);
+}
+
 template<class T>
 template<class TPredicate>
 auto Enumerable<T>::Last(TPredicate predicate, value_type defaultValue) && -> value_type {
@@ -1315,15 +4407,12 @@ auto Enumerable<T>::Last(value_type defaultValue) const & -> value_type {
 template<class T>
 template<class TKeySelector, class TComparer>
 auto Enumerable<T>::OrderBy(TKeySelector keySelector, TComparer comparer) && -> Enumerable {
-    std::vector<value_type> values{};
-    for (auto i = std::move(*this).begin(), j = end(); i != j; ++i) {
-        auto&& source = *i;
-        values.push_back(source);
-    }
-    std::sort(std::begin(values), std::end(values), [&] (auto&& lhs, auto&& rhs) { return comparer(keySelector(lhs), keySelector(rhs)); });
-    for (auto&& value : values) {
-        co_yield value;
+    auto orderedBy = detail::OrderTag<TKeySelector, TComparer>();
+    if (detail::IsSameOrder(orderedBy_, orderedBy)) {
+        return Enumerable{controller_, orderedBy_};
     }
+    auto ordering = std::make_shared<detail::KeyOrdering<value_type, TKeySelector, TComparer>>(std::move(keySelector), std::move(comparer));
+    return Enumerable{Controller{typename Controller::Ordered{controller_, std::move(ordering)}}, orderedBy};
 }
 
 template<class T>
@@ -1348,7 +4437,7 @@ auto Enumerable<T>::OrderBy(TKeySelector keySelector) const & -> Enumerable {
 
 template<class T>
 auto Enumerable<T>::OrderBy() && -> Enumerable {
-    return std::move(*this).OrderBy(&detail::noop_selector<value_type>, std::less<value_type>{});
+    return std::move(*this).OrderBy(std::identity{}, std::less<value_type>{});
 }
 
 template<class T>
@@ -1372,7 +4461,7 @@ auto Enumerable<T>::OrderByDescending(TKeySelector keySelector) const & -> Enume
 
 template<class T>
 auto Enumerable<T>::OrderByDescending() && -> Enumerable {
-    return std::move(*this).OrderByDescending(&detail::noop_selector<value_type>);
+    return std::move(*this).OrderBy(std::identity{}, std::greater<value_type>{});
 }
 
 template<class T>
@@ -1381,6 +4470,107 @@ auto Enumerable<T>::OrderByDescending() const & -> Enumerable {
     return std::move(*const_cast<Enumerable*>(this)).OrderByDescending();
 }
 
+template<class T>
+template<class TSerializer, class TKeySelector, class TComparer>
+auto Enumerable<T>::OrderByExternal(TKeySelector keySelector, TComparer comparer, size_type memoryBudget) && -> Enumerable {
+    auto orderedBy = detail::OrderTag<TKeySelector, TComparer>();
+    if (detail::IsSameOrder(orderedBy_, orderedBy)) {
+        return Enumerable{controller_, orderedBy_};
+    }
+    auto sorted = std::move(*this).template OrderByExternalImpl<TSerializer>(std::move(keySelector), std::move(comparer), detail::GovernedBudget(memoryBudget));
+    return Enumerable{std::move(sorted.controller_), orderedBy};
+}
+
+template<class T>
+template<class TSerializer, class TKeySelector, class TComparer>
+auto Enumerable<T>::OrderByExternal(TKeySelector keySelector, TComparer comparer, size_type memoryBudget) const & -> Enumerable {
+    controller_.Flush();
+    return std::move(*const_cast<Enumerable*>(this)).template OrderByExternal<TSerializer>(keySelector, comparer, memoryBudget);
+}
+
+template<class T>
+template<class TSerializer, class TKeySelector>
+auto Enumerable<T>::OrderByExternal(TKeySelector keySelector, size_type memoryBudget) && -> Enumerable {
+    return std::move(*this).template OrderByExternal<TSerializer>(keySelector, std::less<std::invoke_result_t<TKeySelector, reference>>{}, memoryBudget);
+}
+
+template<class T>
+template<class TSerializer, class TKeySelector>
+auto Enumerable<T>::OrderByExternal(TKeySelector keySelector, size_type memoryBudget) const & -> Enumerable {
+    controller_.Flush();
+    return std::move(*const_cast<Enumerable*>(this)).template OrderByExternal<TSerializer>(keySelector, memoryBudget);
+}
+
+// External merge sort: sorts memoryBudget-sized runs in memory and spills them. Runs are kept in levels; whenever a level holds kMaxFanIn
+// runs they are merged into one run of the next level, so the number of open files grows only logarithmically with the input.
+// Higher levels hold earlier elements, which keeps the final merge stable.
+template<class T>
+template<class TSerializer, class TKeySelector, class TComparer>
+auto Enumerable<T>::OrderByExternalImpl(TKeySelector keySelector, TComparer comparer, size_type memoryBudget) && -> Enumerable {
+    constexpr std::size_t kMaxFanIn = 64;
+
+    auto less = [&] (const value_type& lhs, const value_type& rhs) { return comparer(keySelector(lhs), keySelector(rhs)); };
+    auto sort = [&] (Container& values) {
+        if (!detail::MergeRuns(std::begin(values), std::end(values), less)) {
+            std::stable_sort(std::begin(values), std::end(values), less);
+        }
+    };
+
+    std::vector<std::vector<detail::TemporaryFile>> levels{};
+    auto push = [&] (detail::TemporaryFile run) {
+        for (std::size_t level = 0;; ++level) {
+            if (level == std::size(levels)) {
+                levels.emplace_back();
+            }
+            levels[level].push_back(std::move(run));
+            if (std::size(levels[level]) < kMaxFanIn) {
+                return;
+            }
+            run = detail::TemporaryFile{};
+            auto merge = detail::MergeSpilledRuns<value_type, TSerializer>(std::move(levels[level]), less);
+            for (auto i = std::move(merge).begin(), j = end(); i != j; ++i) {
+                TSerializer::Write(run.Get(), *i);
+            }
+            levels[level].clear();
+        }
+    };
+
+    auto runLength = std::max<size_type>(memoryBudget / sizeof(value_type), 1);
+    detail::MemoryCharge charge{"OrderBy"};
+    Container values{};
+    for (auto i = std::move(*this).begin(), j = end(); i != j; ++i) {
+        values.push_back(*i);
+        charge.Update(std::size(values) * sizeof(value_type));
+        if (std::size(values) == runLength) {
+            sort(values);
+            push(detail::SpillRun<TSerializer>(std::begin(values), std::end(values)));
+            values.clear();
+        }
+    }
+    sort(values);
+    if (levels.empty()) {
+        for (auto&& value : values) {
+            co_yield value;
+        }
+        co_return;
+    }
+    if (!values.empty()) {
+        push(detail::SpillRun<TSerializer>(std::begin(values), std::end(values)));
+    }
+    Container{}.swap(values);
+    charge.Release();
+
+    std::vector<detail::TemporaryFile> runs{};
+    for (auto level = std::rbegin(levels); level != std::rend(levels); ++level) {
+        std::move(std::begin(*level), std::end(*level), std::back_inserter(runs));
+    }
+    auto merge = detail::MergeSpilledRuns<value_type, TSerializer>(std::move(runs), less);
+    for (auto i = std::move(merge).begin(), j = end(); i != j; ++i) {
+        auto&& source = *i;
+        co_yield source;
+    }
+}
+
 template<class T>
 auto Enumerable<T>::Prepend(value_type element) && -> Enumerable {
     auto i = std::move(*this).begin(), j = end();
@@ -1399,10 +4589,12 @@ auto Enumerable<T>::Prepend(value_type element) const & -> Enumerable {
 
 template<class T>
 auto Enumerable<T>::Reverse() && -> Enumerable {
+    detail::MemoryCharge charge{"Reverse"};
     std::vector<value_type> values{};
     for (auto i = std::move(*this).begin(), j = end(); i != j; ++i) {
         auto&& source = *i;
         values.push_back(source);
+        charge.Update(values.capacity() * sizeof(value_type));
     }
     for (auto i = std::rbegin(values), j = std::rend(values); i != j; ++i) {
         auto&& value = *i;
@@ -1588,8 +4780,26 @@ auto Enumerable<T>::Single(value_type defaultValue) const & -> value_type {
     return std::move(*const_cast<Enumerable*>(this)).Single(std::move(defaultValue));
 }
 
+template<class T>
+auto Enumerable<T>::SizeHint() const -> std::optional<size_type> {
+    return controller_.SizeHint();
+}
+
+template<class T>
+auto Enumerable<T>::UpperBound() const -> std::optional<size_type> {
+    return controller_.UpperBound();
+}
+
 template<class T>
 auto Enumerable<T>::Skip(int count) && -> Enumerable {
+    if (controller_.IsOrdered()) {
+        return Enumerable{Controller{controller_.GetOrdered().Skip(count)}, orderedBy_};
+    }
+    return std::move(*this).SkipImpl(count);
+}
+
+template<class T>
+auto Enumerable<T>::SkipImpl(int count) && -> Enumerable {
     auto i = std::move(*this).begin(), j = end();
     for (; (count > 0) && (i != j); --count, ++i) {
     }
@@ -1655,8 +4865,34 @@ auto Enumerable<T>::SkipWhileWithIndex(TPredicate predicate) const & -> Enumerab
     return std::move(*const_cast<Enumerable*>(this)).SkipWhileWithIndex(predicate);
 }
 
+template<class T>
+template<class TKeySelector, class TValueSelector>
+auto Enumerable<T>::SumBy(TKeySelector keySelector, TValueSelector valueSelector) &&
+        -> Enumerable<std::pair<std::decay_t<std::invoke_result_t<TKeySelector, reference>>, std::decay_t<std::invoke_result_t<TValueSelector, reference>>>> {
+    using Value = std::decay_t<std::invoke_result_t<TValueSelector, reference>>;
+    return std::move(*this).AggregateBy(keySelector, Value{}, [valueSelector] (Value sum, reference source) -> Value {
+        return std::move(sum) + valueSelector(source);
+    });
+}
+
+template<class T>
+template<class TKeySelector, class TValueSelector>
+auto Enumerable<T>::SumBy(TKeySelector keySelector, TValueSelector valueSelector) const &
+        -> Enumerable<std::pair<std::decay_t<std::invoke_result_t<TKeySelector, reference>>, std::decay_t<std::invoke_result_t<TValueSelector, reference>>>> {
+    controller_.Flush();
+    return std::move(*const_cast<Enumerable*>(this)).SumBy(keySelector, valueSelector);
+}
+
 template<class T>
 auto Enumerable<T>::Take(int count) && -> Enumerable {
+    if (controller_.IsOrdered()) {
+        return Enumerable{Controller{controller_.GetOrdered().Take(count)}, orderedBy_};
+    }
+    return std::move(*this).TakeImpl(count);
+}
+
+template<class T>
+auto Enumerable<T>::TakeImpl(int count) && -> Enumerable {
     for (auto i = std::move(*this).begin(), j = end(); (count > 0) && (i != j); --count, ++i) {
         auto&& source = *i;
         co_yield source;
@@ -1666,104 +4902,307 @@ auto Enumerable<T>::Take(int count) && -> Enumerable {
 template<class T>
 auto Enumerable<T>::Take(int count) const & -> Enumerable {
     controller_.Flush();
-    return std::move(*const_cast<Enumerable*>(this)).Take(count);
+    return std::move(*const_cast<Enumerable*>(this)).Take(count);
+}
+
+template<class T>
+auto Enumerable<T>::TakeLast(int count) && -> Enumerable {
+    return Skip(static_cast<int>(Count()) - count); // must flush
+}
+
+template<class T>
+auto Enumerable<T>::TakeLast(int count) const & -> Enumerable {
+    controller_.Flush();
+    return std::move(*const_cast<Enumerable*>(this)).TakeLast(count);
+}
+
+template<class T>
+template<class TPredicate>
+auto Enumerable<T>::TakeWhile(TPredicate predicate) && -> Enumerable {
+    for (auto i = std::move(*this).begin(), j = end(); (i != j) && predicate(*i); ++i) {
+        auto&& source = *i;
+        co_yield source;
+    }
+}
+
+template<class T>
+template<class TPredicate>
+auto Enumerable<T>::TakeWhile(TPredicate predicate) const & -> Enumerable {
+    controller_.Flush();
+    return std::move(*const_cast<Enumerable*>(this)).TakeWhile(predicate);
+}
+
+template<class T>
+template<class TPredicate>
+auto Enumerable<T>::TakeWhileWithIndex(TPredicate predicate) && -> Enumerable {
+    int index = 0;
+    for (auto i = std::move(*this).begin(), j = end(); (i != j) && predicate(*i, index); ++i, ++index) {
+        auto&& source = *i;
+        co_yield source;
+    }
+}
+
+template<class T>
+template<class TPredicate>
+auto Enumerable<T>::TakeWhileWithIndex(TPredicate predicate) const & -> Enumerable {
+    controller_.Flush();
+    return std::move(*const_cast<Enumerable*>(this)).TakeWhileWithIndex(predicate);
+}
+
+template<class T>
+template<template<class, class...> class TContainer, class... U>
+auto Enumerable<T>::ToContainer() && -> TContainer<value_type, U...> {
+    return TContainer<value_type, U...>{std::move(*this).begin(), end()};
+}
+
+template<class T>
+template<template<class, class...> class TContainer, class... U>
+auto Enumerable<T>::ToContainer() const & -> TContainer<value_type, U...> {
+    controller_.Flush();
+    return std::move(*const_cast<Enumerable*>(this)).template ToContainer<TContainer, U...>();
+}
+
+template<class T>
+auto Enumerable<T>::ToContainer() && -> Container {
+    return Container{std::move(*this).begin(), end()};
+}
+
+template<class T>
+auto Enumerable<T>::ToContainer() const & -> Container {
+    controller_.Flush();
+    return std::move(*const_cast<Enumerable*>(this)).ToContainer();
+}
+
+template<class T>
+template<class TKeySelector>
+auto Enumerable<T>::ToDictionary(TKeySelector keySelector) && {
+    return std::move(*this).ToDictionary(keySelector, [] (reference source) { return source; });
+}
+
+template<class T>
+template<class TKeySelector>
+auto Enumerable<T>::ToDictionary(TKeySelector keySelector) const & {
+    controller_.Flush();
+    return std::move(*const_cast<Enumerable*>(this)).ToDictionary(keySelector);
+}
+
+template<class T>
+template<class TKeySelector, class TElementSelector>
+auto Enumerable<T>::ToDictionary(TKeySelector keySelector, TElementSelector elementSelector) && {
+    using Key = std::decay_t<std::invoke_result_t<TKeySelector, reference>>;
+    if constexpr (detail::is_default_hashable_v<Key>) {
+        return std::move(*this).template ToDictionaryHash<Hash<Key>>(keySelector, elementSelector);
+    } else if constexpr (detail::is_default_lessable_v<Key>) {
+        return std::move(*this).template ToDictionaryLess<std::less<Key>>(keySelector, elementSelector);
+    } else {
+        //static_assert(false, "This type doesn't support std::hash and std::less. Please call ToDictionaryHash/ToDictionaryLess with specific comparer.");
+    }
+}
+
+template<class T>
+template<class TKeySelector, class TElementSelector>
+auto Enumerable<T>::ToDictionary(TKeySelector keySelector, TElementSelector elementSelector) const & {
+    controller_.Flush();
+    return std::move(*const_cast<Enumerable*>(this)).ToDictionary(keySelector, elementSelector);
+}
+
+template<class T>
+template<class THash, template<class...> class TMap, class TKeySelector, class TElementSelector>
+auto Enumerable<T>::ToDictionaryHash(
+        TKeySelector keySelector,
+        TElementSelector elementSelector) && -> TMap<std::decay_t<std::invoke_result_t<TKeySelector, reference>>, std::decay_t<std::invoke_result_t<TElementSelector, reference>>, THash> {
+    TMap<std::decay_t<std::invoke_result_t<TKeySelector, reference>>, std::decay_t<std::invoke_result_t<TElementSelector, reference>>, THash> dictionary{};
+    // Reserving once avoids rehashing every element several times while the table grows.
+    if (auto size = SizeHint()) {
+        dictionary.reserve(*size);
+    }
+    for (auto i = std::move(*this).begin(), j = end(); i != j; ++i) {
+        auto&& source = *i;
+        if (!dictionary.try_emplace(keySelector(source), elementSelector(source)).second) {
+            throw std::invalid_argument{"cpplinq: ToDictionary found a duplicate key"};
+        }
+    }
+    return dictionary;
+}
+
+template<class T>
+template<class THash, template<class...> class TMap, class TKeySelector, class TElementSelector>
+auto Enumerable<T>::ToDictionaryHash(
+        TKeySelector keySelector,
+        TElementSelector elementSelector) const & -> TMap<std::decay_t<std::invoke_result_t<TKeySelector, reference>>, std::decay_t<std::invoke_result_t<TElementSelector, reference>>, THash> {
+    controller_.Flush();
+    return std::move(*const_cast<Enumerable*>(this)).template ToDictionaryHash<THash, TMap>(keySelector, elementSelector);
+}
+
+template<class T>
+template<class TLess, class TKeySelector, class TElementSelector>
+auto Enumerable<T>::ToDictionaryLess(
+        TKeySelector keySelector,
+        TElementSelector elementSelector) && -> std::map<std::decay_t<std::invoke_result_t<TKeySelector, reference>>, std::decay_t<std::invoke_result_t<TElementSelector, reference>>, TLess> {
+    using Key = std::decay_t<std::invoke_result_t<TKeySelector, reference>>;
+    using Element = std::decay_t<std::invoke_result_t<TElementSelector, reference>>;
+    std::vector<std::pair<Key, Element>> entries{};
+    if (auto size = SizeHint()) {
+        entries.reserve(*size);
+    }
+    for (auto i = std::move(*this).begin(), j = end(); i != j; ++i) {
+        auto&& source = *i;
+        entries.emplace_back(keySelector(source), elementSelector(source));
+    }
+    TLess less{};
+    std::sort(std::begin(entries), std::end(entries), [&] (const auto& lhs, const auto& rhs) { return less(lhs.first, rhs.first); });
+    // Every entry goes after the last one, so the hinted insertion is amortized constant time instead of a search down the tree.
+    std::map<Key, Element, TLess> dictionary{less};
+    for (auto&& entry : entries) {
+        if (!std::empty(dictionary) && !less(std::prev(std::end(dictionary))->first, entry.first)) {
+            throw std::invalid_argument{"cpplinq: ToDictionary found a duplicate key"};
+        }
+        dictionary.emplace_hint(std::end(dictionary), std::move(entry));
+    }
+    return dictionary;
+}
+
+template<class T>
+template<class TLess, class TKeySelector, class TElementSelector>
+auto Enumerable<T>::ToDictionaryLess(
+        TKeySelector keySelector,
+        TElementSelector elementSelector) const & -> std::map<std::decay_t<std::invoke_result_t<TKeySelector, reference>>, std::decay_t<std::invoke_result_t<TElementSelector, reference>>, TLess> {
+    controller_.Flush();
+    return std::move(*const_cast<Enumerable*>(this)).template ToDictionaryLess<TLess>(keySelector, elementSelector);
+}
+
+template<class T>
+template<class THash, template<class...> class TSet>
+auto Enumerable<T>::ToHashSet() && -> TSet<value_type, THash> {
+    TSet<value_type, THash> set{};
+    if (auto size = SizeHint()) {
+        set.reserve(*size);
+    }
+    for (auto i = std::move(*this).begin(), j = end(); i != j; ++i) {
+        set.insert(*i);
+    }
+    return set;
+}
+
+template<class T>
+template<class THash, template<class...> class TSet>
+auto Enumerable<T>::ToHashSet() const & -> TSet<value_type, THash> {
+    controller_.Flush();
+    return std::move(*const_cast<Enumerable*>(this)).template ToHashSet<THash, TSet>();
 }
 
 template<class T>
-auto Enumerable<T>::TakeLast(int count) && -> Enumerable {
-    return Skip(static_cast<int>(Count()) - count); // must flush
+template<class TKeySelector>
+auto Enumerable<T>::ToLookup(TKeySelector keySelector) && -> Lookup<std::decay_t<std::invoke_result_t<TKeySelector, reference>>, value_type> {
+    return std::move(*this).ToLookup(keySelector, [] (reference source) { return source; });
 }
 
 template<class T>
-auto Enumerable<T>::TakeLast(int count) const & -> Enumerable {
+template<class TKeySelector>
+auto Enumerable<T>::ToLookup(TKeySelector keySelector) const & -> Lookup<std::decay_t<std::invoke_result_t<TKeySelector, reference>>, value_type> {
     controller_.Flush();
-    return std::move(*const_cast<Enumerable*>(this)).TakeLast(count);
+    return std::move(*const_cast<Enumerable*>(this)).ToLookup(keySelector);
 }
 
 template<class T>
-template<class TPredicate>
-auto Enumerable<T>::TakeWhile(TPredicate predicate) && -> Enumerable {
-    for (auto i = std::move(*this).begin(), j = end(); (i != j) && predicate(*i); ++i) {
-        auto&& source = *i;
-        co_yield source;
-    }
+template<class TKeySelector, class TElementSelector>
+auto Enumerable<T>::ToLookup(
+        TKeySelector keySelector,
+        TElementSelector elementSelector) && -> Lookup<std::decay_t<std::invoke_result_t<TKeySelector, reference>>, std::decay_t<std::invoke_result_t<TElementSelector, reference>>> {
+    using Key = std::decay_t<std::invoke_result_t<TKeySelector, reference>>;
+    return std::move(*this).template ToLookupHash<Hash<Key>>(keySelector, elementSelector);
 }
 
 template<class T>
-template<class TPredicate>
-auto Enumerable<T>::TakeWhile(TPredicate predicate) const & -> Enumerable {
+template<class TKeySelector, class TElementSelector>
+auto Enumerable<T>::ToLookup(
+        TKeySelector keySelector,
+        TElementSelector elementSelector) const & -> Lookup<std::decay_t<std::invoke_result_t<TKeySelector, reference>>, std::decay_t<std::invoke_result_t<TElementSelector, reference>>> {
     controller_.Flush();
-    return std::move(*const_cast<Enumerable*>(this)).TakeWhile(predicate);
+    return std::move(*const_cast<Enumerable*>(this)).ToLookup(keySelector, elementSelector);
 }
 
 template<class T>
-template<class TPredicate>
-auto Enumerable<T>::TakeWhileWithIndex(TPredicate predicate) && -> Enumerable {
-    int index = 0;
-    for (auto i = std::move(*this).begin(), j = end(); (i != j) && predicate(*i, index); ++i, ++index) {
-        auto&& source = *i;
-        co_yield source;
-    }
+template<class THash, class TKeySelector, class TElementSelector>
+auto Enumerable<T>::ToLookupHash(
+        TKeySelector keySelector,
+        TElementSelector elementSelector) && -> Lookup<std::decay_t<std::invoke_result_t<TKeySelector, reference>>, std::decay_t<std::invoke_result_t<TElementSelector, reference>>, THash> {
+    // The Lookup streams a second handle on the same state, which leaves this Enumerable as it is, like any other && operator.
+    return {Enumerable{controller_}, keySelector, elementSelector};
 }
 
 template<class T>
-template<class TPredicate>
-auto Enumerable<T>::TakeWhileWithIndex(TPredicate predicate) const & -> Enumerable {
+template<class THash, class TKeySelector, class TElementSelector>
+auto Enumerable<T>::ToLookupHash(
+        TKeySelector keySelector,
+        TElementSelector elementSelector) const & -> Lookup<std::decay_t<std::invoke_result_t<TKeySelector, reference>>, std::decay_t<std::invoke_result_t<TElementSelector, reference>>, THash> {
     controller_.Flush();
-    return std::move(*const_cast<Enumerable*>(this)).TakeWhileWithIndex(predicate);
+    return std::move(*const_cast<Enumerable*>(this)).template ToLookupHash<THash>(keySelector, elementSelector);
 }
 
 template<class T>
-template<template<class, class...> class TContainer, class... U>
-auto Enumerable<T>::ToContainer() && -> TContainer<value_type, U...> {
-    return TContainer<value_type, U...>{std::move(*this).begin(), end()};
+template<class THash>
+auto Enumerable<T>::UnionHash(const Enumerable& other) && -> Enumerable {
+    return std::move(*this).template UnionHashImpl<THash>(other, std::nullopt);
 }
 
 template<class T>
-template<template<class, class...> class TContainer, class... U>
-auto Enumerable<T>::ToContainer() const & -> TContainer<value_type, U...> {
+template<class THash>
+auto Enumerable<T>::UnionHash(const Enumerable& other) const & -> Enumerable {
     controller_.Flush();
-    return std::move(*const_cast<Enumerable*>(this)).template ToContainer<TContainer, U...>();
+    return std::move(*const_cast<Enumerable*>(this)).template UnionHash<THash>(other);
 }
 
 template<class T>
-auto Enumerable<T>::ToContainer() && -> Container {
-    return Container{std::move(*this).begin(), end()};
+template<class THash>
+auto Enumerable<T>::UnionHash(const Enumerable& other, ExpectedCount expectedCount) && -> Enumerable {
+    return std::move(*this).template UnionHashImpl<THash>(other, static_cast<size_type>(expectedCount));
 }
 
 template<class T>
-auto Enumerable<T>::ToContainer() const & -> Container {
+template<class THash>
+auto Enumerable<T>::UnionHash(const Enumerable& other, ExpectedCount expectedCount) const & -> Enumerable {
     controller_.Flush();
-    return std::move(*const_cast<Enumerable*>(this)).ToContainer();
+    return std::move(*const_cast<Enumerable*>(this)).template UnionHash<THash>(other, expectedCount);
 }
 
 template<class T>
 template<class THash>
-auto Enumerable<T>::UnionHash(const Enumerable& other) && -> Enumerable {
-    std::unordered_set<value_type, THash> values{std::begin(other), std::end(other)};
+auto Enumerable<T>::UnionHashImpl(Enumerable other, std::optional<size_type> expectedCount) && -> Enumerable {
+    detail::MemoryCharge charge{"Union"};
+    detail::KeyIndex<value_type, THash> values{};
+    auto size = SizeHint(), otherSize = other.SizeHint();
+    detail::Presizer presizer{values, expectedCount, (size && otherSize) ? std::optional{*size + *otherSize} : std::nullopt};
     for (auto i = std::move(*this).begin(), j = end(); i != j; ++i) {
         auto&& source = *i;
-        values.insert(source);
+        auto [number, inserted] = values.Insert(source);
+        presizer.Indexed(number);
+        if (inserted) {
+            charge.Update(values.Bytes());
+            co_yield source;
+        }
     }
-    for (auto&& value : values) {
-        co_yield value;
+    for (auto i = std::move(other).begin(), j = other.end(); i != j; ++i) {
+        auto&& source = *i;
+        auto [number, inserted] = values.Insert(source);
+        presizer.Indexed(number);
+        if (inserted) {
+            charge.Update(values.Bytes());
+            co_yield source;
+        }
     }
 }
 
-template<class T>
-template<class THash>
-auto Enumerable<T>::UnionHash(const Enumerable& other) const & -> Enumerable {
-    controller_.Flush();
-    return std::move(*const_cast<Enumerable*>(this)).template UnionHash<THash>(other);
-}
-
 template<class T>
 template<class TLess>
 auto Enumerable<T>::UnionLess(const Enumerable& other) && -> Enumerable {
     std::set<value_type, TLess> values{std::begin(other), std::end(other)};
+    detail::MemoryCharge charge{"Union"};
+    charge.Update(std::size(values) * sizeof(value_type));
     for (auto i = std::move(*this).begin(), j = end(); i != j; ++i) {
         auto&& source = *i;
         values.insert(source);
+        charge.Update(std::size(values) * sizeof(value_type));
     }
     for (auto&& value : values) {
         co_yield value;
@@ -1781,11 +5220,14 @@ template<class T>
 template<class TEqual>
 auto Enumerable<T>::UnionEqual(const Enumerable& other) && -> Enumerable {
     std::vector<value_type> values{std::begin(other.DistinctEqual<TEqual>()), std::end(other)};
+    detail::MemoryCharge charge{"Union"};
+    charge.Update(std::size(values) * sizeof(value_type));
     TEqual equal{};
     for (auto i = std::move(*this).template DistinctEqual<TEqual>().begin(), j = end(); i != j; ++i) {
         auto&& source = *i;
         if (std::find_if(std::begin(values), std::end(values), [&] (auto&& value) { return equal(source, value); }) == std::end(values)) {
             values.push_back(source);
+            charge.Update(std::size(values) * sizeof(value_type));
         }
     }
     for (auto&& value : values) {
@@ -1800,10 +5242,60 @@ auto Enumerable<T>::UnionEqual(const Enumerable& other) const & -> Enumerable {
     return std::move(*const_cast<Enumerable*>(this)).template UnionEqual<TEqual>(other);
 }
 
+template<class T>
+auto Enumerable<T>::UnionBitmap(Enumerable other) && -> Enumerable {
+    auto combined = std::move(*this).CombineBitmaps(std::move(other), [] (detail::Bitmap& lhs, const detail::Bitmap& rhs) { lhs |= rhs; }, "Union");
+    return Enumerable{std::move(combined.controller_), detail::OrderTag<std::identity, std::less<value_type>>()};
+}
+
+template<class T>
+auto Enumerable<T>::UnionBitmap(Enumerable other) const & -> Enumerable {
+    controller_.Flush();
+    return std::move(*const_cast<Enumerable*>(this)).UnionBitmap(std::move(other));
+}
+
+template<class T>
+template<class TLess>
+auto Enumerable<T>::UnionSorted(Enumerable other) && -> Enumerable {
+    auto merged = std::move(*this).template UnionSortedImpl<TLess>(std::move(other));
+    return Enumerable{std::move(merged.controller_), detail::OrderTag<std::identity, TLess>()};
+}
+
+template<class T>
+template<class TLess>
+auto Enumerable<T>::UnionSorted(Enumerable other) const & -> Enumerable {
+    controller_.Flush();
+    return std::move(*const_cast<Enumerable*>(this)).template UnionSorted<TLess>(std::move(other));
+}
+
+template<class T>
+template<class TLess>
+auto Enumerable<T>::UnionSortedImpl(Enumerable other) && -> Enumerable {
+    TLess less{};
+    std::optional<value_type> last{};
+    auto i = std::move(*this).begin();
+    auto j = std::move(other).begin();
+    for (auto k = end(); (i != k) || (j != k);) {
+        auto first = (j == k) || ((i != k) && !less(*j, *i));
+        auto&& source = first ? *i : *j;
+        if (!last || less(*last, source)) {
+            last = source;
+            co_yield *last;
+        }
+        if (first) {
+            ++i;
+        } else {
+            ++j;
+        }
+    }
+}
+
 template<class T>
 auto Enumerable<T>::Union(const Enumerable& other) && -> Enumerable {
+    // Unlike Intersect and Except, Union never merges sorted inputs: a merge interleaves the two sequences, while Union yields all of the
+    // first before any of the second.
     if constexpr (detail::is_default_hashable_v<value_type>) {
-        return std::move(*this).template UnionHash<std::hash<value_type>>(other);
+        return std::move(*this).template UnionHash<Hash<value_type>>(other);
     } else if constexpr (detail::is_default_lessable_v<value_type>) {
         return std::move(*this).template UnionLess<std::less<value_type>>(other);
     } else if constexpr (detail::is_default_equalable_v<value_type>) {
@@ -1837,6 +5329,198 @@ auto Enumerable<T>::Where(TPredicate predicate) const & -> Enumerable {
     return std::move(*const_cast<Enumerable*>(this)).Where(predicate);
 }
 
+template<class T>
+template<class TEnumerable, class TKeySelector, class TInnerKeySelector>
+auto Enumerable<T>::WhereIn(const TEnumerable& inner, TKeySelector keySelector, TInnerKeySelector innerKeySelector) && -> Enumerable {
+    using Key = std::decay_t<std::invoke_result_t<TKeySelector, reference>>;
+    if constexpr (detail::is_default_hashable_v<Key>) {
+        return std::move(*this).template WhereInHash<Hash<Key>>(inner, keySelector, innerKeySelector);
+    } else if constexpr (detail::is_default_lessable_v<Key>) {
+        return std::move(*this).template WhereInLess<std::less<Key>>(inner, keySelector, innerKeySelector);
+    } else {
+        //static_assert(false, "This type doesn't support std::hash and std::less. Please call WhereInHash/WhereInLess with specific comparer.");
+    }
+}
+
+template<class T>
+template<class TEnumerable, class TKeySelector, class TInnerKeySelector>
+auto Enumerable<T>::WhereIn(const TEnumerable& inner, TKeySelector keySelector, TInnerKeySelector innerKeySelector) const & -> Enumerable {
+    controller_.Flush();
+    return std::move(*const_cast<Enumerable*>(this)).WhereIn(inner, keySelector, innerKeySelector);
+}
+
+template<class T>
+template<class TKey, class TElement, class THash, class TKeySelector>
+auto Enumerable<T>::WhereIn(Lookup<TKey, TElement, THash> inner, TKeySelector keySelector) && -> Enumerable {
+    for (auto i = std::move(*this).begin(), j = end(); i != j; ++i) {
+        auto&& source = *i;
+        if (inner.Contains(keySelector(source))) {
+            co_yield source;
+        }
+    }
+}
+
+template<class T>
+template<class TKey, class TElement, class THash, class TKeySelector>
+auto Enumerable<T>::WhereIn(Lookup<TKey, TElement, THash> inner, TKeySelector keySelector) const & -> Enumerable {
+    controller_.Flush();
+    return std::move(*const_cast<Enumerable*>(this)).WhereIn(std::move(inner), keySelector);
+}
+
+template<class T>
+template<class THash, class TEnumerable, class TKeySelector, class TInnerKeySelector>
+auto Enumerable<T>::WhereInHash(const TEnumerable& inner, TKeySelector keySelector, TInnerKeySelector innerKeySelector) && -> Enumerable {
+    using Key = std::decay_t<std::invoke_result_t<TKeySelector, reference>>;
+    return std::move(*this).template WhereInImpl<std::unordered_set<Key, THash, std::equal_to<>>>(inner, keySelector, innerKeySelector, true);
+}
+
+template<class T>
+template<class THash, class TEnumerable, class TKeySelector, class TInnerKeySelector>
+auto Enumerable<T>::WhereInHash(const TEnumerable& inner, TKeySelector keySelector, TInnerKeySelector innerKeySelector) const & -> Enumerable {
+    controller_.Flush();
+    return std::move(*const_cast<Enumerable*>(this)).template WhereInHash<THash>(inner, keySelector, innerKeySelector);
+}
+
+template<class T>
+template<class TLess, class TEnumerable, class TKeySelector, class TInnerKeySelector>
+auto Enumerable<T>::WhereInLess(const TEnumerable& inner, TKeySelector keySelector, TInnerKeySelector innerKeySelector) && -> Enumerable {
+    using Key = std::decay_t<std::invoke_result_t<TKeySelector, reference>>;
+    return std::move(*this).template WhereInImpl<std::set<Key, TLess>>(inner, keySelector, innerKeySelector, true);
+}
+
+template<class T>
+template<class TLess, class TEnumerable, class TKeySelector, class TInnerKeySelector>
+auto Enumerable<T>::WhereInLess(const TEnumerable& inner, TKeySelector keySelector, TInnerKeySelector innerKeySelector) const & -> Enumerable {
+    controller_.Flush();
+    return std::move(*const_cast<Enumerable*>(this)).template WhereInLess<TLess>(inner, keySelector, innerKeySelector);
+}
+
+template<class T>
+template<class TSet, class TEnumerable, class TKeySelector, class TInnerKeySelector>
+auto Enumerable<T>::WhereInImpl(const TEnumerable& inner, TKeySelector keySelector, TInnerKeySelector innerKeySelector, bool in) && -> Enumerable {
+    TSet keys{};
+    detail::MemoryCharge charge{in ? "WhereIn" : "WhereNotIn"};
+    for (auto&& element : inner) {
+        keys.insert(innerKeySelector(element));
+        charge.Update(std::size(keys) * sizeof(typename TSet::value_type));
+    }
+    std::optional<detail::BloomFilter> filter{};
+    if constexpr (requires { keys.hash_function(); }) {
+        filter = detail::KeyFilter(keys);
+        charge.Update(std::size(keys) * sizeof(typename TSet::value_type) + (filter ? filter->Bytes() : 0));
+    }
+    for (auto i = std::move(*this).begin(), j = end(); i != j; ++i) {
+        auto&& source = *i;
+        auto&& key = keySelector(source);
+        auto found = false;
+        if constexpr (requires { keys.hash_function(); }) {
+            found = (!filter || filter->MayContain(keys.hash_function()(key))) && keys.contains(key);
+        } else {
+            found = keys.contains(key);
+        }
+        if (found == in) {
+            co_yield source;
+        }
+    }
+}
+
+template<class T>
+template<class THash, class TEnumerable, class TKeySelector, class TInnerKeySelector>
+auto Enumerable<T>::WhereMayJoin(const TEnumerable& inner, TKeySelector keySelector, TInnerKeySelector innerKeySelector) && -> Enumerable {
+    THash hash{};
+    std::vector<std::size_t> hashes{};
+    detail::MemoryCharge charge{"WhereMayJoin"};
+    for (auto&& element : inner) {
+        hashes.push_back(hash(innerKeySelector(element)));
+        charge.Update(hashes.capacity() * sizeof(std::size_t));
+    }
+    detail::BloomFilter filter{std::size(hashes)};
+    for (auto value : hashes) {
+        filter.Insert(value);
+    }
+    charge.Update(hashes.capacity() * sizeof(std::size_t) + filter.Bytes());
+    hashes = {};
+    for (auto i = std::move(*this).begin(), j = end(); i != j; ++i) {
+        auto&& source = *i;
+        if (filter.MayContain(hash(keySelector(source)))) {
+            co_yield source;
+        }
+    }
+}
+
+template<class T>
+template<class THash, class TEnumerable, class TKeySelector, class TInnerKeySelector>
+auto Enumerable<T>::WhereMayJoin(const TEnumerable& inner, TKeySelector keySelector, TInnerKeySelector innerKeySelector) const & -> Enumerable {
+    controller_.Flush();
+    return std::move(*const_cast<Enumerable*>(this)).template WhereMayJoin<THash>(inner, keySelector, innerKeySelector);
+}
+
+template<class T>
+template<class TEnumerable, class TKeySelector, class TInnerKeySelector>
+auto Enumerable<T>::WhereNotIn(const TEnumerable& inner, TKeySelector keySelector, TInnerKeySelector innerKeySelector) && -> Enumerable {
+    using Key = std::decay_t<std::invoke_result_t<TKeySelector, reference>>;
+    if constexpr (detail::is_default_hashable_v<Key>) {
+        return std::move(*this).template WhereNotInHash<Hash<Key>>(inner, keySelector, innerKeySelector);
+    } else if constexpr (detail::is_default_lessable_v<Key>) {
+        return std::move(*this).template WhereNotInLess<std::less<Key>>(inner, keySelector, innerKeySelector);
+    } else {
+        //static_assert(false, "This type doesn't support std::hash and std::less. Please call WhereNotInHash/WhereNotInLess with specific comparer.");
+    }
+}
+
+template<class T>
+template<class TEnumerable, class TKeySelector, class TInnerKeySelector>
+auto Enumerable<T>::WhereNotIn(const TEnumerable& inner, TKeySelector keySelector, TInnerKeySelector innerKeySelector) const & -> Enumerable {
+    controller_.Flush();
+    return std::move(*const_cast<Enumerable*>(this)).WhereNotIn(inner, keySelector, innerKeySelector);
+}
+
+template<class T>
+template<class TKey, class TElement, class THash, class TKeySelector>
+auto Enumerable<T>::WhereNotIn(Lookup<TKey, TElement, THash> inner, TKeySelector keySelector) && -> Enumerable {
+    for (auto i = std::move(*this).begin(), j = end(); i != j; ++i) {
+        auto&& source = *i;
+        if (!inner.Contains(keySelector(source))) {
+            co_yield source;
+        }
+    }
+}
+
+template<class T>
+template<class TKey, class TElement, class THash, class TKeySelector>
+auto Enumerable<T>::WhereNotIn(Lookup<TKey, TElement, THash> inner, TKeySelector keySelector) const & -> Enumerable {
+    controller_.Flush();
+    return std::move(*const_cast<Enumerable*>(this)).WhereNotIn(std::move(inner), keySelector);
+}
+
+template<class T>
+template<class THash, class TEnumerable, class TKeySelector, class TInnerKeySelector>
+auto Enumerable<T>::WhereNotInHash(const TEnumerable& inner, TKeySelector keySelector, TInnerKeySelector innerKeySelector) && -> Enumerable {
+    using Key = std::decay_t<std::invoke_result_t<TKeySelector, reference>>;
+    return std::move(*this).template WhereInImpl<std::unordered_set<Key, THash, std::equal_to<>>>(inner, keySelector, innerKeySelector, false);
+}
+
+template<class T>
+template<class THash, class TEnumerable, class TKeySelector, class TInnerKeySelector>
+auto Enumerable<T>::WhereNotInHash(const TEnumerable& inner, TKeySelector keySelector, TInnerKeySelector innerKeySelector) const & -> Enumerable {
+    controller_.Flush();
+    return std::move(*const_cast<Enumerable*>(this)).template WhereNotInHash<THash>(inner, keySelector, innerKeySelector);
+}
+
+template<class T>
+template<class TLess, class TEnumerable, class TKeySelector, class TInnerKeySelector>
+auto Enumerable<T>::WhereNotInLess(const TEnumerable& inner, TKeySelector keySelector, TInnerKeySelector innerKeySelector) && -> Enumerable {
+    using Key = std::decay_t<std::invoke_result_t<TKeySelector, reference>>;
+    return std::move(*this).template WhereInImpl<std::set<Key, TLess>>(inner, keySelector, innerKeySelector, false);
+}
+
+template<class T>
+template<class TLess, class TEnumerable, class TKeySelector, class TInnerKeySelector>
+auto Enumerable<T>::WhereNotInLess(const TEnumerable& inner, TKeySelector keySelector, TInnerKeySelector innerKeySelector) const & -> Enumerable {
+    controller_.Flush();
+    return std::move(*const_cast<Enumerable*>(this)).template WhereNotInLess<TLess>(inner, keySelector, innerKeySelector);
+}
+
 template<class T>
 template<class TPredicate>
 auto Enumerable<T>::WhereWithIndex(TPredicate predicate) && -> Enumerable {
@@ -1938,4 +5622,240 @@ const TKey& Grouping<TKey, TElement>::Key() const {
 
 #pragma endregion Grouping
 
+#pragma region Lookup
+
+template<class TKey, class TElement, class THash>
+struct Lookup<TKey, TElement, THash>::State {
+    // Keys are compared with std::equal_to<>, so that a transparent THash lets any type comparable with TKey be looked up as it is.
+    using Groups = std::unordered_map<TKey, std::vector<TElement>, THash, std::equal_to<>>;
+
+    struct Slot {
+        TKey key;
+        std::vector<TElement> elements;
+    }; // struct Slot
+
+    template<class U>
+    const std::vector<TElement>* Find(const U& key) const {
+        if (perfectHash) {
+            if (std::empty(slots)) {
+                return nullptr;
+            }
+            auto&& slot = slots[perfectHash->Position(groups.hash_function()(key))];
+            return (slot.key == key) ? &slot.elements : nullptr;
+        }
+        if (filter && !filter->MayContain(groups.hash_function()(key))) {
+            return nullptr;
+        }
+        auto itr = groups.find(key);
+        return (itr != std::end(groups)) ? &itr->second : nullptr;
+    }
+
+    // A digest of what THash makes of the keys of the slots. Written to the file so that Read can tell that it hashes the keys
+    // differently, whether THash is another function or the same one built differently, e.g. std::hash on another platform.
+    std::uint64_t HashDigest() const {
+        std::vector<std::uint64_t> hashes{};
+        hashes.reserve(std::size(slots));
+        for (auto&& slot : slots) {
+            hashes.push_back(groups.hash_function()(slot.key));
+        }
+        return detail::HashBytes(std::data(hashes), std::size(hashes) * sizeof(std::uint64_t));
+    }
+
+    Groups groups{};
+    // The groups in the order their keys first appeared. Nodes of an unordered_map never move, so the pointers stay valid.
+    std::vector<const typename Groups::value_type*> order{};
+    std::optional<detail::BloomFilter> filter{};
+    // The frozen form: the groups at their perfect hash positions, and those positions in the order the keys first appeared.
+    std::optional<detail::PerfectHash> perfectHash{};
+    std::vector<Slot> slots{};
+    std::vector<std::uint32_t> slotOrder{};
+    std::vector<TElement> none{};
+}; // struct Lookup::State
+
+template<class TKey, class TElement, class THash>
+Lookup<TKey, TElement, THash>::Lookup() : state_{std::make_shared<const State>()} {
+}
+
+template<class TKey, class TElement, class THash>
+template<class TSource, class TKeySelector, class TElementSelector>
+Lookup<TKey, TElement, THash>::Lookup(Enumerable<TSource> source, TKeySelector keySelector, TElementSelector elementSelector) {
+    auto state = std::make_shared<State>();
+    for (auto i = std::move(source).begin(), j = source.end(); i != j; ++i) {
+        auto&& element = *i;
+        auto [itr, inserted] = state->groups.try_emplace(keySelector(element));
+        if (inserted) {
+            state->order.push_back(&*itr);
+        }
+        itr->second.push_back(elementSelector(element));
+    }
+    // Lookups are built to be probed many times, mostly for keys they don't have.
+    state->filter = detail::KeyFilter(state->groups);
+    state_ = std::move(state);
+}
+
+template<class TKey, class TElement, class THash>
+template<class U>
+bool Lookup<TKey, TElement, THash>::Contains(const U& key) const {
+    return state_->Find(key) != nullptr;
+}
+
+template<class TKey, class TElement, class THash>
+auto Lookup<TKey, TElement, THash>::Count() const noexcept -> size_type {
+    return state_->perfectHash ? std::size(state_->slots) : std::size(state_->groups);
+}
+
+template<class TKey, class TElement, class THash>
+template<class U>
+const std::vector<TElement>& Lookup<TKey, TElement, THash>::operator[](const U& key) const {
+    auto elements = state_->Find(key);
+    return elements ? *elements : state_->none;
+}
+
+template<class TKey, class TElement, class THash>
+template<class U>
+std::shared_ptr<const std::vector<TElement>> Lookup<TKey, TElement, THash>::Share(const U& key) const {
+    auto elements = state_->Find(key);
+    return {state_, elements ? elements : &state_->none};
+}
+
+template<class TKey, class TElement, class THash>
+Enumerable<Grouping<TKey, TElement>> Lookup<TKey, TElement, THash>::AsEnumerable() const {
+    return AsEnumerableImpl(state_);
+}
+
+template<class TKey, class TElement, class THash>
+Enumerable<Grouping<TKey, TElement>> Lookup<TKey, TElement, THash>::AsEnumerableImpl(std::shared_ptr<const State> state) {
+    if (state->perfectHash) {
+        for (auto position : state->slotOrder) {
+            auto&& slot = state->slots[position];
+            co_yield Grouping<TKey, TElement>{slot.key, slot.elements};
+        }
+    } else {
+        for (auto group : state->order) {
+            co_yield Grouping<TKey, TElement>{group->first, group->second};
+        }
+    }
+}
+
+template<class TKey, class TElement, class THash>
+auto Lookup<TKey, TElement, THash>::Freeze() const -> Lookup {
+    if (state_->perfectHash) {
+        return *this;
+    }
+    auto hash = state_->groups.hash_function();
+    std::vector<std::uint64_t> hashes{};
+    hashes.reserve(std::size(state_->order));
+    for (auto group : state_->order) {
+        hashes.push_back(hash(group->first));
+    }
+    auto perfectHash = detail::PerfectHash::Build(hashes);
+    if (!perfectHash) {
+        return *this;
+    }
+
+    auto state = std::make_shared<State>();
+    std::vector<std::size_t> groupAt(std::size(hashes));
+    state->slotOrder.reserve(std::size(hashes));
+    for (std::size_t i = 0; i < std::size(hashes); ++i) {
+        auto position = perfectHash->Position(static_cast<std::size_t>(hashes[i]));
+        groupAt[position] = i;
+        state->slotOrder.push_back(static_cast<std::uint32_t>(position));
+    }
+    state->slots.reserve(std::size(hashes));
+    for (auto i : groupAt) {
+        state->slots.push_back({state_->order[i]->first, state_->order[i]->second});
+    }
+    state->perfectHash = std::move(perfectHash);
+    Lookup result{};
+    result.state_ = std::move(state);
+    return result;
+}
+
+template<class TKey, class TElement, class THash>
+void Lookup<TKey, TElement, THash>::Write(std::FILE* file) const {
+    auto frozen = Freeze();
+    if (!frozen.state_->perfectHash) {
+        throw std::runtime_error{"cpplinq: the hash function maps two keys of the Lookup to the same value"};
+    }
+    auto&& state = *frozen.state_;
+    detail::WriteBytes(file, std::data(detail::kLookupMagic), std::size(detail::kLookupMagic));
+    Serializer<std::uint32_t>::Write(file, detail::kLookupFormatVersion);
+    Serializer<std::uint64_t>::Write(file, state.HashDigest());
+    state.perfectHash->Write(file);
+    for (auto&& slot : state.slots) {
+        Serializer<TKey>::Write(file, slot.key);
+        Serializer<std::size_t>::Write(file, std::size(slot.elements));
+        for (auto&& element : slot.elements) {
+            Serializer<TElement>::Write(file, element);
+        }
+    }
+    detail::WriteBytes(file, std::data(state.slotOrder), std::size(state.slotOrder) * sizeof(std::uint32_t));
+}
+
+template<class TKey, class TElement, class THash>
+auto Lookup<TKey, TElement, THash>::Read(std::FILE* file) -> Lookup {
+    auto fail = [] {
+        return std::runtime_error{"cpplinq: failed to read a Lookup"};
+    };
+    std::array<char, std::size(detail::kLookupMagic)> magic{};
+    if (!detail::ReadBytes(file, std::data(magic), std::size(magic)) || (magic != detail::kLookupMagic)) {
+        throw std::runtime_error{"cpplinq: the file doesn't hold a Lookup"};
+    }
+    if (Serializer<std::uint32_t>::Read(file) != detail::kLookupFormatVersion) {
+        throw std::runtime_error{"cpplinq: the Lookup was written in an unsupported format"};
+    }
+    auto digest = Serializer<std::uint64_t>::Read(file);
+    if (!digest) {
+        throw fail();
+    }
+    auto state = std::make_shared<State>();
+    state->perfectHash = detail::PerfectHash::Read(file);
+    if (!state->perfectHash) {
+        throw fail();
+    }
+    auto size = state->perfectHash->Size();
+    state->slots.reserve(size);
+    for (std::size_t i = 0; i < size; ++i) {
+        auto key = Serializer<TKey>::Read(file);
+        auto count = Serializer<std::size_t>::Read(file);
+        if (!key || !count) {
+            throw fail();
+        }
+        std::vector<TElement> elements{};
+        for (std::size_t j = 0; j < *count; ++j) {
+            auto element = Serializer<TElement>::Read(file);
+            if (!element) {
+                throw fail();
+            }
+            elements.push_back(std::move(*element));
+        }
+        state->slots.push_back({std::move(*key), std::move(elements)});
+    }
+    if (!detail::ReadArray(file, state->slotOrder, size)) {
+        throw fail();
+    }
+    // The order must name every slot exactly once.
+    std::vector<bool> seen(size);
+    for (auto position : state->slotOrder) {
+        if ((position >= size) || seen[position]) {
+            throw fail();
+        }
+        seen[position] = true;
+    }
+    if (state->HashDigest() != *digest) {
+        throw std::runtime_error{"cpplinq: the Lookup was written with a different hash function"};
+    }
+    // Each key must sit where the perfect hash puts it, or it could never be found.
+    for (std::size_t i = 0; i < size; ++i) {
+        if (state->perfectHash->Position(state->groups.hash_function()(state->slots[i].key)) != i) {
+            throw fail();
+        }
+    }
+    Lookup result{};
+    result.state_ = std::move(state);
+    return result;
+}
+
+#pragma endregion Lookup
+
 } // namespace cpplinq
@@ -1,28 +1,213 @@
 #pragma once
 
 #include <algorithm>
+#include <array>
+#include <bit>
+#include <cmath>
 #include <coroutine>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <exception>
 #include <functional>
 #include <initializer_list>
 #include <iterator>
+#include <limits>
 #include <map>
 #include <memory>
+#include <mutex>
 #include <numeric>
 #include <optional>
+#include <ranges>
 #include <set>
+#include <stdexcept>
+#include <string>
+#include <string_view>
 #include <type_traits>
+#include <typeinfo>
 #include <unordered_map>
 #include <unordered_set>
+#include <utility>
 #include <variant>
 #include <vector>
 
 namespace cpplinq {
 
+#pragma region Serializer
+
+//! Encodes values in the binary form operators use when they spill data to temporary files.
+//! Trivially copyable types are written as their raw bytes. Specialize Serializer for any other element type that has to be spilled.
+//!
+//! @tparam T The type of the values to encode.
+template<class T>
+struct Serializer {
+    static_assert(std::is_trivially_copyable_v<T>, "This type isn't trivially copyable. Please specialize cpplinq::Serializer for it.");
+
+    //! Appends value to file.
+    static void Write(std::FILE* file, const T& value);
+
+    //! Reads the next value from file.
+    //!
+    //! @returns The value, or std::nullopt at the end of file.
+    static std::optional<T> Read(std::FILE* file);
+}; // struct Serializer
+
+template<class TChar, class TTraits, class TAllocator>
+struct Serializer<std::basic_string<TChar, TTraits, TAllocator>> {
+    static void Write(std::FILE* file, const std::basic_string<TChar, TTraits, TAllocator>& value);
+
+    static std::optional<std::basic_string<TChar, TTraits, TAllocator>> Read(std::FILE* file);
+}; // struct Serializer<std::basic_string>
+
+template<class T1, class T2>
+struct Serializer<std::pair<T1, T2>> {
+    static void Write(std::FILE* file, const std::pair<T1, T2>& value);
+
+    static std::optional<std::pair<T1, T2>> Read(std::FILE* file);
+}; // struct Serializer<std::pair>
+
+#pragma endregion Serializer
+
+#pragma region Hash
+
+//! The default hash function of the hash-based operators. Integers, enums and pointers go through a multiply-xorshift mixer, so keys that
+//! differ only in their high bits still spread over a table; any other type falls back to std::hash.
+//!
+//! @tparam T The type of the keys to hash.
+template<class T>
+struct Hash {
+    std::size_t operator()(const T& value) const;
+}; // struct Hash
+
+//! Strings are hashed eight bytes at a time in the style of wyhash. The hash is transparent: a table of strings can be probed with a
+//! std::basic_string_view or a null-terminated string without building a std::basic_string.
+template<class TChar, class TTraits, class TAllocator>
+struct Hash<std::basic_string<TChar, TTraits, TAllocator>> {
+    using is_transparent = void;
+
+    std::size_t operator()(std::basic_string_view<TChar, TTraits> value) const noexcept;
+}; // struct Hash<std::basic_string>
+
+template<class TChar, class TTraits>
+struct Hash<std::basic_string_view<TChar, TTraits>> : Hash<std::basic_string<TChar, TTraits>> {
+}; // struct Hash<std::basic_string_view>
+
+#pragma endregion Hash
+
+#pragma region MemoryContext
+
+//! The exception thrown when an operator would make a MemoryContext exceed its limit.
+class MemoryLimitExceeded : public std::runtime_error {
+public:
+    MemoryLimitExceeded(std::string_view name, std::size_t limit);
+
+    //! @returns The name of the operator that hit the limit, e.g. "GroupBy".
+    const std::string& Operator() const noexcept;
+
+    //! @returns The limit of the MemoryContext in bytes.
+    std::size_t Limit() const noexcept;
+
+private:
+    std::string operator_;
+    std::size_t limit_;
+}; // class MemoryLimitExceeded
+
+//! Accounts for the memory held by the buffering operators of a query: Flush (copying or assigning a lazy Enumerable), OrderBy, Reverse,
+//! Distinct, GroupBy, AggregateBy, GroupJoin, Join, Union, Intersect and Except. An operator charges the context that is current on its thread when it
+//! starts, estimating sizeof of every key and element it buffers.
+//! Operators that can spill (the overloads taking a memoryBudget) shrink their budget to what the context has left; any other operator
+//! throws MemoryLimitExceeded when it would exceed the limit.
+//!
+//! @note A context must outlive the queries started while it is current.
+//! @note Spilling splits data by key hash, four levels deep at most. Whatever still doesn't fit at the last level, such as the elements of
+//!       a single key, is held in memory and charged like any other operator, so even an overload taking a memoryBudget throws
+//!       MemoryLimitExceeded then.
+class MemoryContext {
+public:
+    //! Makes a context current on this thread until the scope ends.
+    class Scope {
+    public:
+        explicit Scope(MemoryContext& context) noexcept;
+
+        Scope(const Scope& rhs) = delete;
+        Scope& operator=(const Scope& rhs) = delete;
+
+        ~Scope();
+
+    private:
+        MemoryContext* previous_;
+    }; // class MemoryContext::Scope
+
+    explicit MemoryContext(std::size_t limit = std::numeric_limits<std::size_t>::max()) noexcept;
+
+    MemoryContext(const MemoryContext& rhs) = delete;
+    MemoryContext& operator=(const MemoryContext& rhs) = delete;
+
+    //! @returns The context current on this thread, or nullptr if there is none.
+    static MemoryContext* Current() noexcept;
+
+    std::size_t Limit() const noexcept;
+
+    //! @returns The number of bytes currently charged.
+    std::size_t Usage() const;
+
+    //! @returns The number of bytes that can still be charged.
+    std::size_t Available() const;
+
+    //! @returns The highest number of bytes charged at once.
+    std::size_t Peak() const;
+
+    //! @returns The highest number of bytes each operator had charged at once, by operator name.
+    std::map<std::string, std::size_t> PeakByOperator() const;
+
+    //! Charges bytes to the operator name.
+    //!
+    //! @throws MemoryLimitExceeded if the charge would exceed the limit. Nothing is charged in that case.
+    void Allocate(std::string_view name, std::size_t bytes);
+
+    //! Returns bytes previously charged to the operator name.
+    void Release(std::string_view name, std::size_t bytes) noexcept;
+
+private:
+    struct Account {
+        std::size_t usage{};
+        std::size_t peak{};
+    }; // struct Account
+
+    static MemoryContext*& CurrentImpl() noexcept;
+
+    mutable std::mutex mutex_{};
+    std::size_t limit_;
+    std::size_t usage_{};
+    std::size_t peak_{};
+    std::map<std::string, Account, std::less<>> accounts_{};
+}; // class MemoryContext
+
+#pragma endregion MemoryContext
+
 #pragma region Enumerable
 
+//! The side of a hash join whose elements are put into the hash table; the other side is streamed past it.
+enum class BuildSide {
+    //! The side known to have fewer elements, or the inner side when the sizes are not known up front.
+    Auto,
+    //! The first sequence. Its elements are buffered so that results still come in outer order.
+    Outer,
+    //! The second sequence.
+    Inner,
+}; // enum class BuildSide
+
+//! The number of distinct keys a hash operator expects to see, e.g. ExpectedCount{100000}, so that it sizes its table once up front.
+//! Without one, an operator over a sequence of known size estimates the number from a prefix of it.
+enum class ExpectedCount : std::size_t {};
+
 template<class TKey, class TElement>
 class Grouping;
 
+template<class TKey, class TElement, class THash = Hash<TKey>>
+class Lookup;
+
 template<class T>
 class Enumerable {
 public:
@@ -79,6 +264,36 @@ public:
     //! @see https://docs.microsoft.com/en-us/dotnet/api/system.linq.enumerable.empty?view=net-5.0
     static Enumerable Empty();
 
+    //! Merges sequences that are each sorted by key into one sorted sequence. Elements are pulled lazily through a loser tree, so only one
+    //! element per source is held and each element costs about log2(sources) comparisons.
+    //!
+    //! @tparam TKey The type of the key returned by keySelector. Return type of TKeySelector.
+    //!
+    //! @tparam TKeySelector function<TKey(const T&)>.
+    //! @tparam TComparer function<bool(const TKey&, const TKey&)>.
+    //!
+    //! @param sources The sorted sequences to merge. Pass rvalues to stream them rather than materialize them.
+    //! @param keySelector A function to extract a key from an element.
+    //! @param comparer The comparer every source is sorted by.
+    //!
+    //! @returns An Enumerable<T> that contains the elements of all sources, sorted by key. It counts as the result of
+    //! OrderBy(keySelector, comparer).
+    //!
+    //! @note The merge is stable: elements with equal keys keep their order within a source, and come from earlier sources first.
+    template<class TKeySelector, class TComparer>
+    static Enumerable MergeSorted(std::vector<Enumerable> sources, TKeySelector keySelector, TComparer comparer);
+
+    //! Merges sequences that are each sorted by key in ascending order into one sorted sequence.
+    //!
+    //! @see MergeSorted(std::vector<Enumerable>, TKeySelector, TComparer)
+    template<class TKeySelector>
+    static Enumerable MergeSorted(std::vector<Enumerable> sources, TKeySelector keySelector);
+
+    //! Merges sequences that are each sorted in ascending order into one sorted sequence.
+    //!
+    //! @see MergeSorted(std::vector<Enumerable>, TKeySelector, TComparer)
+    static Enumerable MergeSorted(std::vector<Enumerable> sources);
+
     static Enumerable Range(value_type start, int count);
 
     static Enumerable Repeat(value_type element, int count);
@@ -140,6 +355,63 @@ public:
         TAccumulate seed,
         TAggregator aggregator) const &;
 
+    //! Applies an accumulator function over the elements of each key, without collecting the elements of the groups: only one
+    //! accumulator per key is held, so memory scales with the number of keys rather than the number of elements. Prefer it to
+    //! GroupBy(keySelector).Select(...) whenever each group is reduced to a single value. Uses std::hash if the key supports it,
+    //! otherwise std::less. See AggregateByHash and AggregateByLess.
+    //!
+    //! @tparam TKey The type of the key returned by keySelector. Return type of TKeySelector.
+    //! @tparam TAccumulate The type of the accumulator value.
+    //!
+    //! @tparam TKeySelector function<TKey(const T&)>.
+    //! @tparam TAggregator function<TAccumulate(TAccumulate, const T&)>.
+    //!
+    //! @param keySelector A function to extract the key for each element.
+    //! @param seed The initial accumulator value of each key.
+    //! @param aggregator An accumulator function to be invoked on each element of a key.
+    //!
+    //! @returns An Enumerable<std::pair<TKey, TAccumulate>> with the final accumulator value of each key.
+    //!
+    //! @see https://learn.microsoft.com/en-us/dotnet/api/system.linq.enumerable.aggregateby?view=net-9.0
+    template<class TKeySelector, class TAccumulate, class TAggregator>
+    auto AggregateBy(
+        TKeySelector keySelector,
+        TAccumulate seed,
+        TAggregator aggregator) && -> Enumerable<std::pair<std::decay_t<std::invoke_result_t<TKeySelector, reference>>, TAccumulate>>;
+
+    template<class TKeySelector, class TAccumulate, class TAggregator>
+    auto AggregateBy(
+        TKeySelector keySelector,
+        TAccumulate seed,
+        TAggregator aggregator) const & -> Enumerable<std::pair<std::decay_t<std::invoke_result_t<TKeySelector, reference>>, TAccumulate>>;
+
+    //! Applies an accumulator function over the elements of each key by using THash. The keys come in the order they first appear in
+    //! the sequence.
+    template<class THash, class TKeySelector, class TAccumulate, class TAggregator>
+    auto AggregateByHash(
+        TKeySelector keySelector,
+        TAccumulate seed,
+        TAggregator aggregator) && -> Enumerable<std::pair<std::decay_t<std::invoke_result_t<TKeySelector, reference>>, TAccumulate>>;
+
+    template<class THash, class TKeySelector, class TAccumulate, class TAggregator>
+    auto AggregateByHash(
+        TKeySelector keySelector,
+        TAccumulate seed,
+        TAggregator aggregator) const & -> Enumerable<std::pair<std::decay_t<std::invoke_result_t<TKeySelector, reference>>, TAccumulate>>;
+
+    //! Applies an accumulator function over the elements of each key by using TLess. The keys come sorted by TLess.
+    template<class TLess, class TKeySelector, class TAccumulate, class TAggregator>
+    auto AggregateByLess(
+        TKeySelector keySelector,
+        TAccumulate seed,
+        TAggregator aggregator) && -> Enumerable<std::pair<std::decay_t<std::invoke_result_t<TKeySelector, reference>>, TAccumulate>>;
+
+    template<class TLess, class TKeySelector, class TAccumulate, class TAggregator>
+    auto AggregateByLess(
+        TKeySelector keySelector,
+        TAccumulate seed,
+        TAggregator aggregator) const & -> Enumerable<std::pair<std::decay_t<std::invoke_result_t<TKeySelector, reference>>, TAccumulate>>;
+
     //! Determines whether all elements of a sequence satisfy a condition.
     //!
     //! @tparam TPredicate function<bool(const T&)>.
@@ -190,6 +462,83 @@ public:
 
     Enumerable Append(value_type element) const &;
 
+    //! Pairs each element with the latest element of another sequence whose time is at or before its own, merging both sequences in a
+    //! single pass. Both sequences must be sorted by time in ascending order. Elements with no inner element at or before their time are
+    //! left out, as in Join.
+    //!
+    //! @tparam TTime The type of the times returned by the time selector functions. Return type of TOuterTimeSelector and TInnerTimeSelector.
+    //! @tparam TResult The type of the result elements. Return type of TResultSelector.
+    //!
+    //! @tparam TLess The comparer both sequences are sorted by in ascending order of their times.
+    //! @tparam TInner The type of the elements of the second sequence.
+    //! @tparam TOuterTimeSelector function<TTime(const T&)>.
+    //! @tparam TInnerTimeSelector function<TTime(const TInner&)>.
+    //! @tparam TResultSelector function<TResult(const T&, const TInner&)>.
+    //!
+    //! @param inner The sequence to join to the first sequence. Pass an rvalue to stream it rather than materialize it.
+    //! @param outerTimeSelector A function to extract the time from each element of the first sequence.
+    //! @param innerTimeSelector A function to extract the time from each element of the second sequence.
+    //! @param resultSelector A function to create a result element from an element and the latest inner element at or before it.
+    //!
+    //! @returns An Enumerable<T> that has one element of type TResult for each element of the first sequence that has a match.
+    template<class TLess = std::less<>, class TInner, class TOuterTimeSelector, class TInnerTimeSelector, class TResultSelector>
+    auto AsOfJoin(
+        Enumerable<TInner> inner,
+        TOuterTimeSelector outerTimeSelector,
+        TInnerTimeSelector innerTimeSelector,
+        TResultSelector resultSelector) && -> Enumerable<std::invoke_result_t<TResultSelector, reference, const TInner&>>;
+
+    template<class TLess = std::less<>, class TInner, class TOuterTimeSelector, class TInnerTimeSelector, class TResultSelector>
+    auto AsOfJoin(
+        Enumerable<TInner> inner,
+        TOuterTimeSelector outerTimeSelector,
+        TInnerTimeSelector innerTimeSelector,
+        TResultSelector resultSelector) const & -> Enumerable<std::invoke_result_t<TResultSelector, reference, const TInner&>>;
+
+    //! Pairs each element with the latest element of another sequence that has the same key and a time at or before its own, merging
+    //! both sequences in a single pass. Both sequences must be sorted by time in ascending order; only the latest inner element of each
+    //! key is held in memory. Elements with no such inner element are left out, as in Join.
+    //!
+    //! @tparam TKey The type of the keys returned by the key selector functions. Return type of TOuterKeySelector and TInnerKeySelector.
+    //! @tparam TTime The type of the times returned by the time selector functions. Return type of TOuterTimeSelector and TInnerTimeSelector.
+    //! @tparam TResult The type of the result elements. Return type of TResultSelector.
+    //!
+    //! @tparam TLess The comparer both sequences are sorted by in ascending order of their times.
+    //! @tparam TInner The type of the elements of the second sequence.
+    //! @tparam TOuterKeySelector function<TKey(const T&)>.
+    //! @tparam TInnerKeySelector function<TKey(const TInner&)>.
+    //! @tparam TOuterTimeSelector function<TTime(const T&)>.
+    //! @tparam TInnerTimeSelector function<TTime(const TInner&)>.
+    //! @tparam TResultSelector function<TResult(const T&, const TInner&)>.
+    //!
+    //! @param inner The sequence to join to the first sequence. Pass an rvalue to stream it rather than materialize it.
+    //! @param outerKeySelector A function to extract the join key from each element of the first sequence.
+    //! @param innerKeySelector A function to extract the join key from each element of the second sequence.
+    //! @param outerTimeSelector A function to extract the time from each element of the first sequence.
+    //! @param innerTimeSelector A function to extract the time from each element of the second sequence.
+    //! @param resultSelector A function to create a result element from an element and the latest matching inner element at or before it.
+    //!
+    //! @returns An Enumerable<T> that has one element of type TResult for each element of the first sequence that has a match.
+    //!
+    //! @note Keys are compared with std::hash and std::equal_to, or with std::less if TKey has no std::hash.
+    template<class TLess = std::less<>, class TInner, class TOuterKeySelector, class TInnerKeySelector, class TOuterTimeSelector, class TInnerTimeSelector, class TResultSelector>
+    auto AsOfJoin(
+        Enumerable<TInner> inner,
+        TOuterKeySelector outerKeySelector,
+        TInnerKeySelector innerKeySelector,
+        TOuterTimeSelector outerTimeSelector,
+        TInnerTimeSelector innerTimeSelector,
+        TResultSelector resultSelector) && -> Enumerable<std::invoke_result_t<TResultSelector, reference, const TInner&>>;
+
+    template<class TLess = std::less<>, class TInner, class TOuterKeySelector, class TInnerKeySelector, class TOuterTimeSelector, class TInnerTimeSelector, class TResultSelector>
+    auto AsOfJoin(
+        Enumerable<TInner> inner,
+        TOuterKeySelector outerKeySelector,
+        TInnerKeySelector innerKeySelector,
+        TOuterTimeSelector outerTimeSelector,
+        TInnerTimeSelector innerTimeSelector,
+        TResultSelector resultSelector) const & -> Enumerable<std::invoke_result_t<TResultSelector, reference, const TInner&>>;
+
     //! Concatenates two sequences.
     //!
     //! @param other The sequence to concatenate to the first sequence.
@@ -252,6 +601,23 @@ public:
 
     size_type Count() const &;
 
+    //! Counts the elements of each key, holding one counter per key instead of the groups. See AggregateBy.
+    //!
+    //! @tparam TKey The type of the key returned by keySelector. Return type of TKeySelector.
+    //!
+    //! @tparam TKeySelector function<TKey(const T&)>.
+    //!
+    //! @param keySelector A function to extract the key for each element.
+    //!
+    //! @returns An Enumerable<std::pair<TKey, size_type>> with the number of elements of each key.
+    //!
+    //! @see https://learn.microsoft.com/en-us/dotnet/api/system.linq.enumerable.countby?view=net-9.0
+    template<class TKeySelector>
+    auto CountBy(TKeySelector keySelector) && -> Enumerable<std::pair<std::decay_t<std::invoke_result_t<TKeySelector, reference>>, size_type>>;
+
+    template<class TKeySelector>
+    auto CountBy(TKeySelector keySelector) const & -> Enumerable<std::pair<std::decay_t<std::invoke_result_t<TKeySelector, reference>>, size_type>>;
+
     //! Returns the elements of the specified sequence or the specified value in a singleton collection if the sequence is empty.
     //!
     //! @param defaultValue The value to return if the sequence is empty.
@@ -269,6 +635,34 @@ public:
     template<class THash>
     Enumerable DistinctHash() const &;
 
+    //! Returns distinct elements from a sequence by using THash, with a table sized for expectedCount distinct elements from the start.
+    //!
+    //! @tparam THash The hash function of the elements.
+    //!
+    //! @param expectedCount The number of distinct elements expected.
+    //!
+    //! @returns An Enumerable<T> that contains distinct elements from the source sequence.
+    template<class THash>
+    Enumerable DistinctHash(ExpectedCount expectedCount) &&;
+
+    template<class THash>
+    Enumerable DistinctHash(ExpectedCount expectedCount) const &;
+
+    //! Returns distinct elements from a sequence by using THash, holding at most memoryBudget bytes of elements in memory.
+    //! Elements that don't fit are partitioned by hash into temporary files, and each partition is processed the same way afterwards.
+    //!
+    //! @tparam THash The hash function of the elements.
+    //! @tparam TSerializer The Serializer used to write elements to the temporary files.
+    //!
+    //! @param memoryBudget The number of bytes of distinct elements to keep in memory at once, counted as sizeof(T) per element.
+    //!
+    //! @returns An Enumerable<T> that contains distinct elements from the source sequence.
+    template<class THash, class TSerializer = Serializer<T>>
+    Enumerable DistinctHash(size_type memoryBudget) &&;
+
+    template<class THash, class TSerializer = Serializer<T>>
+    Enumerable DistinctHash(size_type memoryBudget) const &;
+
     template<class TLess>
     Enumerable DistinctLess() &&;
 
@@ -281,10 +675,23 @@ public:
     template<class TEqual>
     Enumerable DistinctEqual() const &;
 
+    //! Returns distinct elements from a sequence of integers, remembering them in a compressed bitmap rather than a hash table. Elements
+    //! are yielded as soon as they are first seen. If the values turn out to be sparse, the bitmap is replaced by a hash table.
+    //!
+    //! @returns An Enumerable<T> that contains distinct elements from the source sequence.
+    //!
+    //! @note Distinct doesn't pick this by itself: on values spread thinly over a wide range the bitmap is slower than a hash table.
+    Enumerable DistinctBitmap() &&;
+
+    Enumerable DistinctBitmap() const &;
+
     //! Returns distinct elements from a sequence by using the default equality comparer to compare values.
     //!
     //! @returns An Enumerable<T> that contains distinct elements from the source sequence.
     //!
+    //! @note With std::hash, elements are yielded as soon as they are first seen. Up to a few dozen distinct elements are kept in a
+    //! plain array and searched linearly; past that a flat hash table indexes them.
+    //!
     //! @see https://docs.microsoft.com/en-us/dotnet/api/system.linq.enumerable.distinct?view=net-5.0#System_Linq_Enumerable_Distinct__1_System_Collections_Generic_IEnumerable___0__
     Enumerable Distinct() &&;
 
@@ -320,6 +727,32 @@ public:
     template<class TEqual>
     Enumerable ExceptEqual(const Enumerable& other) const &;
 
+    //! Produces the set difference of two sequences of integers by building a compressed bitmap of each and subtracting them word by
+    //! word.
+    //!
+    //! @param other The integers to remove. Pass an rvalue to stream it rather than materialize it.
+    //!
+    //! @returns The distinct elements of the first sequence that are not in the second, in ascending order.
+    Enumerable ExceptBitmap(Enumerable other) &&;
+
+    Enumerable ExceptBitmap(Enumerable other) const &;
+
+    //! Produces the set difference of two sequences that are both sorted by TLess by merging them in a single pass, holding no more than one
+    //! element in memory.
+    //!
+    //! @tparam TLess The comparer both sequences are sorted by in ascending order.
+    //!
+    //! @param other The second sequence. Pass an rvalue to stream it rather than materialize it.
+    //!
+    //! @returns The distinct elements of this sequence that don't occur in other, sorted by TLess.
+    //!
+    //! @note Except picks this automatically when both sequences come from OrderBy() or OrderByDescending(), or from a std::set.
+    template<class TLess = std::less<T>>
+    Enumerable ExceptSorted(Enumerable other) &&;
+
+    template<class TLess = std::less<T>>
+    Enumerable ExceptSorted(Enumerable other) const &;
+
     //! Produces the set difference of two sequences by using the default equality comparer to compare values.
     //!
     //! @param other An Enumerable<T> whose elements that also occur in the first sequence will cause those elements to be removed from the returned sequence.
@@ -370,6 +803,67 @@ public:
         TElementSelector elementSelector,
         TResultSelector resultSelector) const & -> Enumerable<std::invoke_result_t<TResultSelector, std::invoke_result_t<TKeySelector, reference>, Enumerable<std::invoke_result_t<TElementSelector, reference>>>>;
 
+    //! Groups the elements of a sequence by using THash, with a table sized for expectedCount keys from the start.
+    //!
+    //! @tparam THash The hash function of the keys.
+    //! @tparam TKeySelector function<TKey(const T&)>.
+    //! @tparam TElementSelector function<TElement(const T&)>.
+    //! @tparam TResultSelector function<TResult(const TKey&, const Enumerable<TElement>&)>.
+    //!
+    //! @param keySelector A function to extract the key for each element.
+    //! @param elementSelector A function to map each source element to an element in a group.
+    //! @param resultSelector A function to create a result value from each group.
+    //! @param expectedCount The number of distinct keys expected.
+    //!
+    //! @returns A collection of elements of type TResult where each element represents a projection over a group and its key.
+    template<class THash, class TKeySelector, class TElementSelector, class TResultSelector>
+    auto GroupByHash(
+        TKeySelector keySelector,
+        TElementSelector elementSelector,
+        TResultSelector resultSelector,
+        ExpectedCount expectedCount) && -> Enumerable<std::invoke_result_t<TResultSelector, std::invoke_result_t<TKeySelector, reference>, Enumerable<std::invoke_result_t<TElementSelector, reference>>>>;
+
+    template<class THash, class TKeySelector, class TElementSelector, class TResultSelector>
+    auto GroupByHash(
+        TKeySelector keySelector,
+        TElementSelector elementSelector,
+        TResultSelector resultSelector,
+        ExpectedCount expectedCount) const & -> Enumerable<std::invoke_result_t<TResultSelector, std::invoke_result_t<TKeySelector, reference>, Enumerable<std::invoke_result_t<TElementSelector, reference>>>>;
+
+    //! Groups the elements of a sequence by using THash, holding at most memoryBudget bytes of keys and source elements in memory.
+    //! Groups are kept in hash partitions; whenever the budget is exceeded, the largest partition held is written to a temporary file with
+    //! its groups, and each file is grouped the same way afterwards. After a few levels of partitioning, the rest is grouped in memory.
+    //!
+    //! @tparam TKey The type of the key returned by keySelector. Return type of TKeySelector.
+    //! @tparam TElement The type of the elements in each group. Return type of TElementSelector.
+    //! @tparam TResult The type of the result value returned by resultSelector. Return type of TResultSelector.
+    //!
+    //! @tparam THash The hash function of the keys.
+    //! @tparam TSerializer The Serializer used to write source elements to the temporary files.
+    //! @tparam TKeySelector function<TKey(const T&)>.
+    //! @tparam TElementSelector function<TElement(const T&)>.
+    //! @tparam TResultSelector function<TResult(const TKey&, const Enumerable<TElement>&)>.
+    //!
+    //! @param keySelector A function to extract the key for each element.
+    //! @param elementSelector A function to map each source element to an element in a group.
+    //! @param resultSelector A function to create a result value from each group.
+    //! @param memoryBudget The number of bytes to hold in memory at once, counted as sizeof(TKey) per group plus sizeof(T) per element.
+    //!
+    //! @returns A collection of elements of type TResult where each element represents a projection over a group and its key.
+    template<class THash, class TSerializer = Serializer<T>, class TKeySelector, class TElementSelector, class TResultSelector>
+    auto GroupByHash(
+        TKeySelector keySelector,
+        TElementSelector elementSelector,
+        TResultSelector resultSelector,
+        size_type memoryBudget) && -> Enumerable<std::invoke_result_t<TResultSelector, std::invoke_result_t<TKeySelector, reference>, Enumerable<std::invoke_result_t<TElementSelector, reference>>>>;
+
+    template<class THash, class TSerializer = Serializer<T>, class TKeySelector, class TElementSelector, class TResultSelector>
+    auto GroupByHash(
+        TKeySelector keySelector,
+        TElementSelector elementSelector,
+        TResultSelector resultSelector,
+        size_type memoryBudget) const & -> Enumerable<std::invoke_result_t<TResultSelector, std::invoke_result_t<TKeySelector, reference>, Enumerable<std::invoke_result_t<TElementSelector, reference>>>>;
+
     template<class TLess, class TKeySelector, class TElementSelector, class TResultSelector>
     auto GroupByLess(
         TKeySelector keySelector,
@@ -410,6 +904,9 @@ public:
     //!
     //! @returns A collection of elements of type TResult where each element represents a projection over a group and its key.
     //!
+    //! @note Every element is held until the groups are complete. If resultSelector only reduces each group to a value, AggregateBy,
+    //! CountBy and SumBy hold one accumulator per key instead.
+    //!
     //! @see https://docs.microsoft.com/en-us/dotnet/api/system.linq.enumerable.groupby?view=net-5.0#System_Linq_Enumerable_GroupBy__4_System_Collections_Generic_IEnumerable___0__System_Func___0___1__System_Func___0___2__System_Func___1_System_Collections_Generic_IEnumerable___2____3__
     template<class TKeySelector, class TElementSelector, class TResultSelector>
     auto GroupBy(
@@ -475,6 +972,87 @@ public:
         TInnerKeySelector innerKeySelector,
         TResultSelector resultSelector) const & -> Enumerable<std::invoke_result_t<TResultSelector, reference, const Enumerable<U>&>>;
 
+    //! Correlates the elements of two sequences based on equality of keys by using THash and groups the results, building the hash
+    //! table over the given side. Results come in the same order either way: by outer element, then by inner element.
+    //!
+    //! @param side The side to build the hash table over. BuildSide::Auto picks the outer side only when both sizes are known without
+    //!             running the sequences (materialized, ordered with Take, or a sized range) and the outer side is the smaller one.
+    //!
+    //! @see GroupJoinHash(const TEnumerable&, TOuterKeySelector, TInnerKeySelector, TResultSelector)
+    template<class THash, class TEnumerable, class TOuterKeySelector, class TInnerKeySelector, class TResultSelector>
+    auto GroupJoinHash(
+        const TEnumerable& inner,
+        TOuterKeySelector outerKeySelector,
+        TInnerKeySelector innerKeySelector,
+        TResultSelector resultSelector,
+        BuildSide side) && -> Enumerable<std::invoke_result_t<TResultSelector, reference, const Enumerable<std::decay_t<decltype(*std::begin(inner))>>&>>;
+
+    template<class THash, class U, class TOuterKeySelector, class TInnerKeySelector, class TResultSelector>
+    auto GroupJoinHash(
+        std::initializer_list<U> inner,
+        TOuterKeySelector outerKeySelector,
+        TInnerKeySelector innerKeySelector,
+        TResultSelector resultSelector,
+        BuildSide side) && -> Enumerable<std::invoke_result_t<TResultSelector, reference, const Enumerable<U>&>>;
+
+    template<class THash, class TEnumerable, class TOuterKeySelector, class TInnerKeySelector, class TResultSelector>
+    auto GroupJoinHash(
+        const TEnumerable& inner,
+        TOuterKeySelector outerKeySelector,
+        TInnerKeySelector innerKeySelector,
+        TResultSelector resultSelector,
+        BuildSide side) const & -> Enumerable<std::invoke_result_t<TResultSelector, reference, const Enumerable<std::decay_t<decltype(*std::begin(inner))>>&>>;
+
+    template<class THash, class U, class TOuterKeySelector, class TInnerKeySelector, class TResultSelector>
+    auto GroupJoinHash(
+        std::initializer_list<U> inner,
+        TOuterKeySelector outerKeySelector,
+        TInnerKeySelector innerKeySelector,
+        TResultSelector resultSelector,
+        BuildSide side) const & -> Enumerable<std::invoke_result_t<TResultSelector, reference, const Enumerable<U>&>>;
+
+    //! Correlates the elements of two sequences based on equality of keys by using THash and groups the results, holding at most
+    //! memoryBudget bytes of the inner sequence in memory. Inner elements are partitioned by key hash; once the budget is used up, the
+    //! largest partitions are spilled to temporary files together with the outer elements that fall into them, and each spilled pair of
+    //! partitions is joined the same way afterwards.
+    //!
+    //! @tparam TInner The type of the elements of the second sequence. Value type of TEnumerable.
+    //! @tparam TKey The type of the keys returned by the key selector functions. Return type of TOuterKeySelector and TInnerKeySelector.
+    //! @tparam TResult The type of the result elements. Return type of TResultSelector.
+    //!
+    //! @tparam THash The hash function of the keys.
+    //! @tparam TSerializer The Serializer used to write outer elements to the temporary files.
+    //! @tparam TInnerSerializer The Serializer used to write inner elements to the temporary files; void stands for Serializer<TInner>.
+    //! @tparam TEnumerable The type of the sequence to join to the first sequence.
+    //! @tparam TOuterKeySelector function<TKey(const T&)>.
+    //! @tparam TInnerKeySelector function<TKey(const TInner&)>.
+    //! @tparam TResultSelector function<TResult(const T&, const Enumerable<TInner>&)>.
+    //!
+    //! @param inner The sequence to join to the first sequence.
+    //! @param outerKeySelector A function to extract the join key from each element of the first sequence.
+    //! @param innerKeySelector A function to extract the join key from each element of the second sequence.
+    //! @param resultSelector A function to create a result element from an element from the first sequence and a collection of matching elements from the second sequence.
+    //! @param memoryBudget The number of bytes of the inner sequence to hold in memory, counted as sizeof(TKey) + sizeof(TInner) per element.
+    //!
+    //! @returns An Enumerable<T> that contains elements of type TResult that are obtained by performing a grouped join on two sequences.
+    //!
+    //! @note Results of spilled partitions come after all others.
+    template<class THash, class TSerializer = Serializer<T>, class TInnerSerializer = void, class TEnumerable, class TOuterKeySelector, class TInnerKeySelector, class TResultSelector>
+    auto GroupJoinHash(
+        const TEnumerable& inner,
+        TOuterKeySelector outerKeySelector,
+        TInnerKeySelector innerKeySelector,
+        TResultSelector resultSelector,
+        size_type memoryBudget) && -> Enumerable<std::invoke_result_t<TResultSelector, reference, const Enumerable<std::decay_t<decltype(*std::begin(inner))>>&>>;
+
+    template<class THash, class TSerializer = Serializer<T>, class TInnerSerializer = void, class TEnumerable, class TOuterKeySelector, class TInnerKeySelector, class TResultSelector>
+    auto GroupJoinHash(
+        const TEnumerable& inner,
+        TOuterKeySelector outerKeySelector,
+        TInnerKeySelector innerKeySelector,
+        TResultSelector resultSelector,
+        size_type memoryBudget) const & -> Enumerable<std::invoke_result_t<TResultSelector, reference, const Enumerable<std::decay_t<decltype(*std::begin(inner))>>&>>;
+
     template<class TLess, class TEnumerable, class TOuterKeySelector, class TInnerKeySelector, class TResultSelector>
     auto GroupJoinLess(
         const TEnumerable& inner,
@@ -531,6 +1109,41 @@ public:
         TInnerKeySelector innerKeySelector,
         TResultSelector resultSelector) const & -> Enumerable<std::invoke_result_t<TResultSelector, reference, const Enumerable<U>&>>;
 
+    //! Correlates the elements of two sequences that are both sorted by key and groups the results, merging them in a single pass. Only
+    //! the inner elements that share the current key are held in memory.
+    //!
+    //! @tparam TKey The type of the keys returned by the key selector functions. Return type of TOuterKeySelector and TInnerKeySelector.
+    //! @tparam TResult The type of the result elements. Return type of TResultSelector.
+    //!
+    //! @tparam TLess The comparer both sequences are sorted by in ascending order of their keys.
+    //! @tparam TInner The type of the elements of the second sequence.
+    //! @tparam TOuterKeySelector function<TKey(const T&)>.
+    //! @tparam TInnerKeySelector function<TKey(const TInner&)>.
+    //! @tparam TResultSelector function<TResult(const T&, const Enumerable<TInner>&)>.
+    //!
+    //! @param inner The sequence to join to the first sequence. Pass an rvalue to stream it rather than materialize it.
+    //! @param outerKeySelector A function to extract the join key from each element of the first sequence.
+    //! @param innerKeySelector A function to extract the join key from each element of the second sequence.
+    //! @param resultSelector A function to create a result element from an element from the first sequence and a collection of matching elements from the second sequence.
+    //!
+    //! @returns An Enumerable<T> that contains elements of type TResult that are obtained by performing a grouped join on two sequences.
+    //!
+    //! @note GroupJoin picks this automatically when inner is an Enumerable and both sequences come from OrderBy with the very key
+    //! selectors passed to it.
+    template<class TLess = std::less<>, class TInner, class TOuterKeySelector, class TInnerKeySelector, class TResultSelector>
+    auto GroupJoinSorted(
+        Enumerable<TInner> inner,
+        TOuterKeySelector outerKeySelector,
+        TInnerKeySelector innerKeySelector,
+        TResultSelector resultSelector) && -> Enumerable<std::invoke_result_t<TResultSelector, reference, const Enumerable<TInner>&>>;
+
+    template<class TLess = std::less<>, class TInner, class TOuterKeySelector, class TInnerKeySelector, class TResultSelector>
+    auto GroupJoinSorted(
+        Enumerable<TInner> inner,
+        TOuterKeySelector outerKeySelector,
+        TInnerKeySelector innerKeySelector,
+        TResultSelector resultSelector) const & -> Enumerable<std::invoke_result_t<TResultSelector, reference, const Enumerable<TInner>&>>;
+
     //! Correlates the elements of two sequences based on equality of keys and groups the results. The default equality comparer is used to compare keys.
     //!
     //! @tparam TInner The type of the elements of the second sequence. Value type of TEnumerable.
@@ -578,6 +1191,34 @@ public:
         TInnerKeySelector innerKeySelector,
         TResultSelector resultSelector) const & -> Enumerable<std::invoke_result_t<TResultSelector, reference, const Enumerable<U>&>>;
 
+    //! Correlates the elements of a sequence with the elements of a Lookup that have the same key and groups the results. The Lookup
+    //! already holds the inner elements by key, so nothing is built per call.
+    //!
+    //! @tparam TKey The type of the keys of the Lookup. Return type of TOuterKeySelector.
+    //! @tparam TInner The type of the elements of the Lookup.
+    //! @tparam TResult The type of the result elements. Return type of TResultSelector.
+    //!
+    //! @tparam THash The hash function of the keys of the Lookup.
+    //! @tparam TOuterKeySelector function<TKey(const T&)>.
+    //! @tparam TResultSelector function<TResult(const T&, const Enumerable<TInner>&)>.
+    //!
+    //! @param inner The Lookup to join to the first sequence.
+    //! @param outerKeySelector A function to extract the join key from each element of the first sequence.
+    //! @param resultSelector A function to create a result element from an element from the first sequence and a collection of matching elements from the Lookup.
+    //!
+    //! @returns An Enumerable<T> that contains elements of type TResult that are obtained by performing a grouped join on two sequences.
+    template<class TKey, class TInner, class THash, class TOuterKeySelector, class TResultSelector>
+    auto GroupJoin(
+        Lookup<TKey, TInner, THash> inner,
+        TOuterKeySelector outerKeySelector,
+        TResultSelector resultSelector) && -> Enumerable<std::invoke_result_t<TResultSelector, reference, const Enumerable<TInner>&>>;
+
+    template<class TKey, class TInner, class THash, class TOuterKeySelector, class TResultSelector>
+    auto GroupJoin(
+        Lookup<TKey, TInner, THash> inner,
+        TOuterKeySelector outerKeySelector,
+        TResultSelector resultSelector) const & -> Enumerable<std::invoke_result_t<TResultSelector, reference, const Enumerable<TInner>&>>;
+
     template<class THash>
     Enumerable IntersectHash(const Enumerable& other) &&;
 
@@ -596,6 +1237,32 @@ public:
     template<class TEqual>
     Enumerable IntersectEqual(const Enumerable& other) const &;
 
+    //! Produces the set intersection of two sequences of integers by building a compressed bitmap of each and intersecting them word by
+    //! word.
+    //!
+    //! @param other The second sequence. Pass an rvalue to stream it rather than materialize it.
+    //!
+    //! @returns The distinct elements that occur in both sequences, in ascending order.
+    Enumerable IntersectBitmap(Enumerable other) &&;
+
+    Enumerable IntersectBitmap(Enumerable other) const &;
+
+    //! Produces the set intersection of two sequences that are both sorted by TLess by merging them in a single pass, holding no more than one
+    //! element in memory.
+    //!
+    //! @tparam TLess The comparer both sequences are sorted by in ascending order.
+    //!
+    //! @param other The second sequence. Pass an rvalue to stream it rather than materialize it.
+    //!
+    //! @returns The distinct elements that occur in both sequences, sorted by TLess.
+    //!
+    //! @note Intersect picks this automatically when both sequences come from OrderBy() or OrderByDescending(), or from a std::set.
+    template<class TLess = std::less<T>>
+    Enumerable IntersectSorted(Enumerable other) &&;
+
+    template<class TLess = std::less<T>>
+    Enumerable IntersectSorted(Enumerable other) const &;
+
     //! Produces the set intersection of two sequences by using the default equality comparer to compare values.
     //!
     //! @param other An Enumerable<T> whose distinct elements that also appear in the first sequence will be returned.
@@ -607,6 +1274,62 @@ public:
 
     Enumerable Intersect(const Enumerable& other) const &;
 
+    //! Correlates the elements of a sequence of intervals with the elements of another sequence whose time falls into them, that is
+    //! start <= time < end. The inner elements are held in memory sorted by time, so each interval finds its first match with a binary
+    //! search and the whole join takes O((n + m) log m + output) time for n intervals and m inner elements. The intervals are streamed and
+    //! may overlap.
+    //!
+    //! @tparam TInner The type of the elements of the second sequence. Value type of TEnumerable.
+    //! @tparam TTime The type of the times returned by the selector functions. Return type of TStartSelector, TEndSelector and TInnerTimeSelector.
+    //! @tparam TResult The type of the result elements. Return type of TResultSelector.
+    //!
+    //! @tparam TLess The comparer of the times.
+    //! @tparam TEnumerable The type of the sequence to join to the first sequence.
+    //! @tparam TStartSelector function<TTime(const T&)>.
+    //! @tparam TEndSelector function<TTime(const T&)>.
+    //! @tparam TInnerTimeSelector function<TTime(const TInner&)>.
+    //! @tparam TResultSelector function<TResult(const T&, const TInner&)>.
+    //!
+    //! @param inner The sequence to join to the first sequence.
+    //! @param startSelector A function to extract the inclusive start of the interval from each element of the first sequence.
+    //! @param endSelector A function to extract the exclusive end of the interval from each element of the first sequence.
+    //! @param innerTimeSelector A function to extract the time from each element of the second sequence.
+    //! @param resultSelector A function to create a result element from an interval and an inner element within it.
+    //!
+    //! @returns An Enumerable<T> that has elements of type TResult for every matching pair, ordered by interval and then by time; inner
+    //!          elements with equal times keep their order.
+    template<class TLess = std::less<>, class TEnumerable, class TStartSelector, class TEndSelector, class TInnerTimeSelector, class TResultSelector>
+    auto IntervalJoin(
+        const TEnumerable& inner,
+        TStartSelector startSelector,
+        TEndSelector endSelector,
+        TInnerTimeSelector innerTimeSelector,
+        TResultSelector resultSelector) && -> Enumerable<std::invoke_result_t<TResultSelector, reference, decltype(*std::begin(inner))>>;
+
+    template<class TLess = std::less<>, class U, class TStartSelector, class TEndSelector, class TInnerTimeSelector, class TResultSelector>
+    auto IntervalJoin(
+        std::initializer_list<U> inner,
+        TStartSelector startSelector,
+        TEndSelector endSelector,
+        TInnerTimeSelector innerTimeSelector,
+        TResultSelector resultSelector) && -> Enumerable<std::invoke_result_t<TResultSelector, reference, const U&>>;
+
+    template<class TLess = std::less<>, class TEnumerable, class TStartSelector, class TEndSelector, class TInnerTimeSelector, class TResultSelector>
+    auto IntervalJoin(
+        const TEnumerable& inner,
+        TStartSelector startSelector,
+        TEndSelector endSelector,
+        TInnerTimeSelector innerTimeSelector,
+        TResultSelector resultSelector) const & -> Enumerable<std::invoke_result_t<TResultSelector, reference, decltype(*std::begin(inner))>>;
+
+    template<class TLess = std::less<>, class U, class TStartSelector, class TEndSelector, class TInnerTimeSelector, class TResultSelector>
+    auto IntervalJoin(
+        std::initializer_list<U> inner,
+        TStartSelector startSelector,
+        TEndSelector endSelector,
+        TInnerTimeSelector innerTimeSelector,
+        TResultSelector resultSelector) const & -> Enumerable<std::invoke_result_t<TResultSelector, reference, const U&>>;
+
     template<class THash, class TEnumerable, class TOuterKeySelector, class TInnerKeySelector, class TResultSelector>
     auto JoinHash(
         const TEnumerable& inner,
@@ -635,6 +1358,87 @@ public:
         TInnerKeySelector innerKeySelector,
         TResultSelector resultSelector) const & -> Enumerable<std::invoke_result_t<TResultSelector, reference, const U&>>;
 
+    //! Correlates the elements of two sequences based on matching keys by using THash, building the hash
+    //! table over the given side. Results come in the same order either way: by outer element, then by inner element.
+    //!
+    //! @param side The side to build the hash table over. BuildSide::Auto picks the outer side only when both sizes are known without
+    //!             running the sequences (materialized, ordered with Take, or a sized range) and the outer side is the smaller one.
+    //!
+    //! @see JoinHash(const TEnumerable&, TOuterKeySelector, TInnerKeySelector, TResultSelector)
+    template<class THash, class TEnumerable, class TOuterKeySelector, class TInnerKeySelector, class TResultSelector>
+    auto JoinHash(
+        const TEnumerable& inner,
+        TOuterKeySelector outerKeySelector,
+        TInnerKeySelector innerKeySelector,
+        TResultSelector resultSelector,
+        BuildSide side) && -> Enumerable<std::invoke_result_t<TResultSelector, reference, decltype(*std::begin(inner))>>;
+
+    template<class THash, class U, class TOuterKeySelector, class TInnerKeySelector, class TResultSelector>
+    auto JoinHash(
+        std::initializer_list<U> inner,
+        TOuterKeySelector outerKeySelector,
+        TInnerKeySelector innerKeySelector,
+        TResultSelector resultSelector,
+        BuildSide side) && -> Enumerable<std::invoke_result_t<TResultSelector, reference, const U&>>;
+
+    template<class THash, class TEnumerable, class TOuterKeySelector, class TInnerKeySelector, class TResultSelector>
+    auto JoinHash(
+        const TEnumerable& inner,
+        TOuterKeySelector outerKeySelector,
+        TInnerKeySelector innerKeySelector,
+        TResultSelector resultSelector,
+        BuildSide side) const & -> Enumerable<std::invoke_result_t<TResultSelector, reference, decltype(*std::begin(inner))>>;
+
+    template<class THash, class U, class TOuterKeySelector, class TInnerKeySelector, class TResultSelector>
+    auto JoinHash(
+        std::initializer_list<U> inner,
+        TOuterKeySelector outerKeySelector,
+        TInnerKeySelector innerKeySelector,
+        TResultSelector resultSelector,
+        BuildSide side) const & -> Enumerable<std::invoke_result_t<TResultSelector, reference, const U&>>;
+
+    //! Correlates the elements of two sequences based on matching keys by using THash, holding at most memoryBudget bytes of the inner
+    //! sequence in memory. Inner elements are partitioned by key hash; once the budget is used up, the largest partitions are spilled to
+    //! temporary files together with the outer elements that fall into them, and each spilled pair of partitions is joined the same way
+    //! afterwards.
+    //!
+    //! @tparam TInner The type of the elements of the second sequence. Value type of TEnumerable.
+    //! @tparam TKey The type of the keys returned by the key selector functions. Return type of TOuterKeySelector and TInnerKeySelector.
+    //! @tparam TResult The type of the result elements. Return type of TResultSelector.
+    //!
+    //! @tparam THash The hash function of the keys.
+    //! @tparam TSerializer The Serializer used to write outer elements to the temporary files.
+    //! @tparam TInnerSerializer The Serializer used to write inner elements to the temporary files; void stands for Serializer<TInner>.
+    //! @tparam TEnumerable The type of the sequence to join to the first sequence.
+    //! @tparam TOuterKeySelector function<TKey(const T&)>.
+    //! @tparam TInnerKeySelector function<TKey(const TInner&)>.
+    //! @tparam TResultSelector function<TResult(const T&, const TInner&)>.
+    //!
+    //! @param inner The sequence to join to the first sequence.
+    //! @param outerKeySelector A function to extract the join key from each element of the first sequence.
+    //! @param innerKeySelector A function to extract the join key from each element of the second sequence.
+    //! @param resultSelector A function to create a result element from two matching elements.
+    //! @param memoryBudget The number of bytes of the inner sequence to hold in memory, counted as sizeof(TKey) + sizeof(TInner) per element.
+    //!
+    //! @returns An Enumerable<T> that has elements of type TResult that are obtained by performing an inner join on two sequences.
+    //!
+    //! @note Results of spilled partitions come after all others.
+    template<class THash, class TSerializer = Serializer<T>, class TInnerSerializer = void, class TEnumerable, class TOuterKeySelector, class TInnerKeySelector, class TResultSelector>
+    auto JoinHash(
+        const TEnumerable& inner,
+        TOuterKeySelector outerKeySelector,
+        TInnerKeySelector innerKeySelector,
+        TResultSelector resultSelector,
+        size_type memoryBudget) && -> Enumerable<std::invoke_result_t<TResultSelector, reference, decltype(*std::begin(inner))>>;
+
+    template<class THash, class TSerializer = Serializer<T>, class TInnerSerializer = void, class TEnumerable, class TOuterKeySelector, class TInnerKeySelector, class TResultSelector>
+    auto JoinHash(
+        const TEnumerable& inner,
+        TOuterKeySelector outerKeySelector,
+        TInnerKeySelector innerKeySelector,
+        TResultSelector resultSelector,
+        size_type memoryBudget) const & -> Enumerable<std::invoke_result_t<TResultSelector, reference, decltype(*std::begin(inner))>>;
+
     template<class TLess, class TEnumerable, class TOuterKeySelector, class TInnerKeySelector, class TResultSelector>
     auto JoinLess(
         const TEnumerable& inner,
@@ -682,14 +1486,49 @@ public:
         const TEnumerable& inner,
         TOuterKeySelector outerKeySelector,
         TInnerKeySelector innerKeySelector,
-        TResultSelector resultSelector) const & -> Enumerable<std::invoke_result_t<TResultSelector, reference, decltype(*std::begin(inner))>>;
+        TResultSelector resultSelector) const & -> Enumerable<std::invoke_result_t<TResultSelector, reference, decltype(*std::begin(inner))>>;
+
+    template<class TEqual, class U, class TOuterKeySelector, class TInnerKeySelector, class TResultSelector>
+    auto JoinEqual(
+        std::initializer_list<U> inner,
+        TOuterKeySelector outerKeySelector,
+        TInnerKeySelector innerKeySelector,
+        TResultSelector resultSelector) const & -> Enumerable<std::invoke_result_t<TResultSelector, reference, const U&>>;
+
+    //! Correlates the elements of two sequences that are both sorted by key, merging them in a single pass. Duplicate keys on either side
+    //! are supported; only the inner elements that share the current key are held in memory.
+    //!
+    //! @tparam TKey The type of the keys returned by the key selector functions. Return type of TOuterKeySelector and TInnerKeySelector.
+    //! @tparam TResult The type of the result elements. Return type of TResultSelector.
+    //!
+    //! @tparam TLess The comparer both sequences are sorted by in ascending order of their keys.
+    //! @tparam TInner The type of the elements of the second sequence.
+    //! @tparam TOuterKeySelector function<TKey(const T&)>.
+    //! @tparam TInnerKeySelector function<TKey(const TInner&)>.
+    //! @tparam TResultSelector function<TResult(const T&, const TInner&)>.
+    //!
+    //! @param inner The sequence to join to the first sequence. Pass an rvalue to stream it rather than materialize it.
+    //! @param outerKeySelector A function to extract the join key from each element of the first sequence.
+    //! @param innerKeySelector A function to extract the join key from each element of the second sequence.
+    //! @param resultSelector A function to create a result element from two matching elements.
+    //!
+    //! @returns An Enumerable<T> that has elements of type TResult that are obtained by performing an inner join on two sequences.
+    //!
+    //! @note Join picks this automatically when inner is an Enumerable and both sequences come from OrderBy with the very key selectors
+    //! passed to it.
+    template<class TLess = std::less<>, class TInner, class TOuterKeySelector, class TInnerKeySelector, class TResultSelector>
+    auto JoinSorted(
+        Enumerable<TInner> inner,
+        TOuterKeySelector outerKeySelector,
+        TInnerKeySelector innerKeySelector,
+        TResultSelector resultSelector) && -> Enumerable<std::invoke_result_t<TResultSelector, reference, const TInner&>>;
 
-    template<class TEqual, class U, class TOuterKeySelector, class TInnerKeySelector, class TResultSelector>
-    auto JoinEqual(
-        std::initializer_list<U> inner,
+    template<class TLess = std::less<>, class TInner, class TOuterKeySelector, class TInnerKeySelector, class TResultSelector>
+    auto JoinSorted(
+        Enumerable<TInner> inner,
         TOuterKeySelector outerKeySelector,
         TInnerKeySelector innerKeySelector,
-        TResultSelector resultSelector) const & -> Enumerable<std::invoke_result_t<TResultSelector, reference, const U&>>;
+        TResultSelector resultSelector) const & -> Enumerable<std::invoke_result_t<TResultSelector, reference, const TInner&>>;
 
     //! Correlates the elements of two sequences based on matching keys. The default equality comparer is used to compare keys.
     //!
@@ -738,6 +1577,34 @@ public:
         TInnerKeySelector innerKeySelector,
         TResultSelector resultSelector) const & -> Enumerable<std::invoke_result_t<TResultSelector, reference, const U&>>;
 
+    //! Correlates the elements of a sequence with the elements of a Lookup that have the same key. The Lookup already holds the inner
+    //! elements by key, so nothing is built per call.
+    //!
+    //! @tparam TKey The type of the keys of the Lookup. Return type of TOuterKeySelector.
+    //! @tparam TInner The type of the elements of the Lookup.
+    //! @tparam TResult The type of the result elements. Return type of TResultSelector.
+    //!
+    //! @tparam THash The hash function of the keys of the Lookup.
+    //! @tparam TOuterKeySelector function<TKey(const T&)>.
+    //! @tparam TResultSelector function<TResult(const T&, const TInner&)>.
+    //!
+    //! @param inner The Lookup to join to the first sequence.
+    //! @param outerKeySelector A function to extract the join key from each element of the first sequence.
+    //! @param resultSelector A function to create a result element from two matching elements.
+    //!
+    //! @returns An Enumerable<T> that has elements of type TResult that are obtained by performing an inner join on two sequences.
+    template<class TKey, class TInner, class THash, class TOuterKeySelector, class TResultSelector>
+    auto Join(
+        Lookup<TKey, TInner, THash> inner,
+        TOuterKeySelector outerKeySelector,
+        TResultSelector resultSelector) && -> Enumerable<std::invoke_result_t<TResultSelector, reference, const TInner&>>;
+
+    template<class TKey, class TInner, class THash, class TOuterKeySelector, class TResultSelector>
+    auto Join(
+        Lookup<TKey, TInner, THash> inner,
+        TOuterKeySelector outerKeySelector,
+        TResultSelector resultSelector) const & -> Enumerable<std::invoke_result_t<TResultSelector, reference, const TInner&>>;
+
     //! Returns the last element of a sequence that satisfies a specified condition.
     //!
     //! @tparam TPredicate function<bool(const T&)>.
@@ -777,6 +1644,11 @@ public:
     //!
     //! @returns An Enumerable<T> whose elements are sorted according to a key.
     //!
+    //! @note Sorting is deferred until the result is enumerated. Take, Skip, First and ElementAt called directly on the result only select the elements they need instead of sorting the whole sequence.
+    //! Other operators chained on an rvalue result sort incrementally, so a consumer that stops early (e.g. TakeWhile) only pays for the elements it reads.
+    //! Input that is already sorted, or made of a few sorted runs, is merged in O(n log runs) instead of being sorted from scratch.
+    //! Sorting again by the same stateless keySelector and comparer types (e.g. OrderBy().OrderBy()) returns the sequence as is.
+    //!
     //! @see https://docs.microsoft.com/en-us/dotnet/api/system.linq.enumerable.orderby?view=net-5.0#System_Linq_Enumerable_OrderBy__2_System_Collections_Generic_IEnumerable___0__System_Func___0___1__System_Collections_Generic_IComparer___1__
     template<class TKeySelector, class TComparer>
     Enumerable OrderBy(TKeySelector keySelector, TComparer comparer) &&;
@@ -832,6 +1704,45 @@ public:
 
     Enumerable OrderByDescending() const &;
 
+    //! Sorts the elements of a sequence by using a specified comparer, holding at most memoryBudget bytes of elements in memory.
+    //! Sorted runs that exceed the budget are written to temporary files and merged back as the result is enumerated.
+    //!
+    //! @tparam TKey The type of the key returned by keySelector. Return type of TKeySelector.
+    //!
+    //! @tparam TSerializer The Serializer used to write elements to the temporary files.
+    //! @tparam TKeySelector function<TKey(const T&)>.
+    //! @tparam TComparer function<bool(const TKey&, const TKey&)>.
+    //!
+    //! @param keySelector A function to extract a key from an element.
+    //! @param comparer A function to compare keys.
+    //! @param memoryBudget The number of bytes of elements to sort in memory at once, counted as sizeof(T) per element.
+    //!
+    //! @returns An Enumerable<T> whose elements are sorted according to a key.
+    //!
+    //! @note The sort is stable, and no file is created if the whole sequence fits in memoryBudget.
+    template<class TSerializer = Serializer<T>, class TKeySelector, class TComparer>
+    Enumerable OrderByExternal(TKeySelector keySelector, TComparer comparer, size_type memoryBudget) &&;
+
+    template<class TSerializer = Serializer<T>, class TKeySelector, class TComparer>
+    Enumerable OrderByExternal(TKeySelector keySelector, TComparer comparer, size_type memoryBudget) const &;
+
+    //! Sorts the elements of a sequence in ascending order according to a key, holding at most memoryBudget bytes of elements in memory.
+    //!
+    //! @tparam TKey The type of the key returned by keySelector. Return type of TKeySelector.
+    //!
+    //! @tparam TSerializer The Serializer used to write elements to the temporary files.
+    //! @tparam TKeySelector function<TKey(const T&)>.
+    //!
+    //! @param keySelector A function to extract a key from an element.
+    //! @param memoryBudget The number of bytes of elements to sort in memory at once, counted as sizeof(T) per element.
+    //!
+    //! @returns An Enumerable<T> whose elements are sorted in ascending order according to a key.
+    template<class TSerializer = Serializer<T>, class TKeySelector>
+    Enumerable OrderByExternal(TKeySelector keySelector, size_type memoryBudget) &&;
+
+    template<class TSerializer = Serializer<T>, class TKeySelector>
+    Enumerable OrderByExternal(TKeySelector keySelector, size_type memoryBudget) const &;
+
     //! Adds a value to the beginning of the sequence.
     //!
     //! @param The value to prepend to source.
@@ -1074,6 +1985,26 @@ public:
     template<class TPredicate>
     Enumerable SkipWhileWithIndex(TPredicate predicate) const &;
 
+    //! Sums a value over the elements of each key, holding one sum per key instead of the groups. See AggregateBy.
+    //!
+    //! @tparam TKey The type of the key returned by keySelector. Return type of TKeySelector.
+    //! @tparam TValue The type of the values to sum. Return type of TValueSelector.
+    //!
+    //! @tparam TKeySelector function<TKey(const T&)>.
+    //! @tparam TValueSelector function<TValue(const T&)>.
+    //!
+    //! @param keySelector A function to extract the key for each element.
+    //! @param valueSelector A function to extract the value to sum from each element.
+    //!
+    //! @returns An Enumerable<std::pair<TKey, TValue>> with the sum of the values of each key, starting from TValue{}.
+    template<class TKeySelector, class TValueSelector>
+    auto SumBy(TKeySelector keySelector, TValueSelector valueSelector) &&
+        -> Enumerable<std::pair<std::decay_t<std::invoke_result_t<TKeySelector, reference>>, std::decay_t<std::invoke_result_t<TValueSelector, reference>>>>;
+
+    template<class TKeySelector, class TValueSelector>
+    auto SumBy(TKeySelector keySelector, TValueSelector valueSelector) const &
+        -> Enumerable<std::pair<std::decay_t<std::invoke_result_t<TKeySelector, reference>>, std::decay_t<std::invoke_result_t<TValueSelector, reference>>>>;
+
     //! Returns a specified number of contiguous elements from the start of a sequence.
     //!
     //! @param count The number of elements to return.
@@ -1144,12 +2075,171 @@ public:
 
     Container ToContainer() const &;
 
+    //! Creates a dictionary from an Enumerable<T> according to a specified key selector function: a std::unordered_map if the key supports
+    //! std::hash, otherwise a std::map. See ToDictionaryHash and ToDictionaryLess.
+    //!
+    //! @tparam TKeySelector function<TKey(const T&)>.
+    //!
+    //! @param keySelector A function to extract a key from each element.
+    //!
+    //! @returns A dictionary that contains keys and values.
+    //!
+    //! @throws std::invalid_argument keySelector produces the same key for two elements.
+    //!
+    //! @see https://docs.microsoft.com/en-us/dotnet/api/system.linq.enumerable.todictionary?view=net-5.0#System_Linq_Enumerable_ToDictionary__2_System_Collections_Generic_IEnumerable___0__System_Func___0___1__
+    template<class TKeySelector>
+    auto ToDictionary(TKeySelector keySelector) &&;
+
+    template<class TKeySelector>
+    auto ToDictionary(TKeySelector keySelector) const &;
+
+    //! Creates a dictionary from an Enumerable<T> according to specified key selector and element selector functions: a
+    //! std::unordered_map if the key supports std::hash, otherwise a std::map. See ToDictionaryHash and ToDictionaryLess.
+    //!
+    //! @tparam TKeySelector function<TKey(const T&)>.
+    //! @tparam TElementSelector function<TElement(const T&)>.
+    //!
+    //! @param keySelector A function to extract a key from each element.
+    //! @param elementSelector A transform function to produce a result element value from each element.
+    //!
+    //! @returns A dictionary that contains values of type TElement selected from the input sequence.
+    //!
+    //! @throws std::invalid_argument keySelector produces the same key for two elements.
+    //!
+    //! @see https://docs.microsoft.com/en-us/dotnet/api/system.linq.enumerable.todictionary?view=net-5.0#System_Linq_Enumerable_ToDictionary__3_System_Collections_Generic_IEnumerable___0__System_Func___0___1__System_Func___0___2__
+    template<class TKeySelector, class TElementSelector>
+    auto ToDictionary(TKeySelector keySelector, TElementSelector elementSelector) &&;
+
+    template<class TKeySelector, class TElementSelector>
+    auto ToDictionary(TKeySelector keySelector, TElementSelector elementSelector) const &;
+
+    //! Creates a hash map from an Enumerable<T>, reserved up front for the size of the sequence when it's known.
+    //!
+    //! @tparam THash The hash function of the keys.
+    //! @tparam TMap A class template with the interface of std::unordered_map, e.g. an open addressing flat map.
+    //!
+    //! @param keySelector A function to extract a key from each element.
+    //! @param elementSelector A transform function to produce a result element value from each element.
+    //!
+    //! @returns A TMap<TKey, TElement, THash> that contains values of type TElement selected from the input sequence.
+    //!
+    //! @throws std::invalid_argument keySelector produces the same key for two elements.
+    template<class THash, template<class...> class TMap = std::unordered_map, class TKeySelector, class TElementSelector>
+    auto ToDictionaryHash(
+        TKeySelector keySelector,
+        TElementSelector elementSelector) && -> TMap<std::decay_t<std::invoke_result_t<TKeySelector, reference>>, std::decay_t<std::invoke_result_t<TElementSelector, reference>>, THash>;
+
+    template<class THash, template<class...> class TMap = std::unordered_map, class TKeySelector, class TElementSelector>
+    auto ToDictionaryHash(
+        TKeySelector keySelector,
+        TElementSelector elementSelector) const & -> TMap<std::decay_t<std::invoke_result_t<TKeySelector, reference>>, std::decay_t<std::invoke_result_t<TElementSelector, reference>>, THash>;
+
+    //! Creates a std::map from an Enumerable<T>. The entries are collected and sorted first, then appended in order, which is cheaper than
+    //! inserting them one by one into the tree.
+    //!
+    //! @tparam TLess The ordering of the keys.
+    //!
+    //! @param keySelector A function to extract a key from each element.
+    //! @param elementSelector A transform function to produce a result element value from each element.
+    //!
+    //! @returns A std::map<TKey, TElement, TLess> that contains values of type TElement selected from the input sequence.
+    //!
+    //! @throws std::invalid_argument keySelector produces equivalent keys for two elements.
+    template<class TLess, class TKeySelector, class TElementSelector>
+    auto ToDictionaryLess(
+        TKeySelector keySelector,
+        TElementSelector elementSelector) && -> std::map<std::decay_t<std::invoke_result_t<TKeySelector, reference>>, std::decay_t<std::invoke_result_t<TElementSelector, reference>>, TLess>;
+
+    template<class TLess, class TKeySelector, class TElementSelector>
+    auto ToDictionaryLess(
+        TKeySelector keySelector,
+        TElementSelector elementSelector) const & -> std::map<std::decay_t<std::invoke_result_t<TKeySelector, reference>>, std::decay_t<std::invoke_result_t<TElementSelector, reference>>, TLess>;
+
+    //! Creates a hash set from an Enumerable<T>, reserved up front for the size of the sequence when it's known.
+    //!
+    //! @tparam THash The hash function of the elements.
+    //! @tparam TSet A class template with the interface of std::unordered_set, e.g. an open addressing flat set.
+    //!
+    //! @returns A TSet<T, THash> that contains the distinct elements of this Enumerable<T>.
+    //!
+    //! @see https://docs.microsoft.com/en-us/dotnet/api/system.linq.enumerable.tohashset?view=net-5.0#System_Linq_Enumerable_ToHashSet__1_System_Collections_Generic_IEnumerable___0__
+    template<class THash = Hash<T>, template<class...> class TSet = std::unordered_set>
+    auto ToHashSet() && -> TSet<value_type, THash>;
+
+    template<class THash = Hash<T>, template<class...> class TSet = std::unordered_set>
+    auto ToHashSet() const & -> TSet<value_type, THash>;
+
+    //! Creates a Lookup from an Enumerable<T> according to a specified key selector function.
+    //!
+    //! @tparam TKey The type of the key returned by keySelector. Return type of TKeySelector.
+    //!
+    //! @tparam TKeySelector function<TKey(const T&)>.
+    //!
+    //! @param keySelector A function to extract a key from each element.
+    //!
+    //! @returns A Lookup<TKey, T> that contains keys and values. The values within each group are in the same order as in the sequence.
+    //!
+    //! @see https://docs.microsoft.com/en-us/dotnet/api/system.linq.enumerable.tolookup?view=net-5.0#System_Linq_Enumerable_ToLookup__2_System_Collections_Generic_IEnumerable___0__System_Func___0___1__
+    template<class TKeySelector>
+    auto ToLookup(TKeySelector keySelector) && -> Lookup<std::decay_t<std::invoke_result_t<TKeySelector, reference>>, value_type>;
+
+    template<class TKeySelector>
+    auto ToLookup(TKeySelector keySelector) const & -> Lookup<std::decay_t<std::invoke_result_t<TKeySelector, reference>>, value_type>;
+
+    //! Creates a Lookup from an Enumerable<T> according to specified key selector and element selector functions.
+    //!
+    //! @tparam TKey The type of the key returned by keySelector. Return type of TKeySelector.
+    //! @tparam TElement The type of the value returned by elementSelector. Return type of TElementSelector.
+    //!
+    //! @tparam TKeySelector function<TKey(const T&)>.
+    //! @tparam TElementSelector function<TElement(const T&)>.
+    //!
+    //! @param keySelector A function to extract a key from each element.
+    //! @param elementSelector A transform function to produce a result element value from each element.
+    //!
+    //! @returns A Lookup<TKey, TElement> that contains values of type TElement selected from the input sequence.
+    //!
+    //! @see https://docs.microsoft.com/en-us/dotnet/api/system.linq.enumerable.tolookup?view=net-5.0#System_Linq_Enumerable_ToLookup__3_System_Collections_Generic_IEnumerable___0__System_Func___0___1__System_Func___0___2__
+    template<class TKeySelector, class TElementSelector>
+    auto ToLookup(
+        TKeySelector keySelector,
+        TElementSelector elementSelector) && -> Lookup<std::decay_t<std::invoke_result_t<TKeySelector, reference>>, std::decay_t<std::invoke_result_t<TElementSelector, reference>>>;
+
+    template<class TKeySelector, class TElementSelector>
+    auto ToLookup(
+        TKeySelector keySelector,
+        TElementSelector elementSelector) const & -> Lookup<std::decay_t<std::invoke_result_t<TKeySelector, reference>>, std::decay_t<std::invoke_result_t<TElementSelector, reference>>>;
+
+    template<class THash, class TKeySelector, class TElementSelector>
+    auto ToLookupHash(
+        TKeySelector keySelector,
+        TElementSelector elementSelector) && -> Lookup<std::decay_t<std::invoke_result_t<TKeySelector, reference>>, std::decay_t<std::invoke_result_t<TElementSelector, reference>>, THash>;
+
+    template<class THash, class TKeySelector, class TElementSelector>
+    auto ToLookupHash(
+        TKeySelector keySelector,
+        TElementSelector elementSelector) const & -> Lookup<std::decay_t<std::invoke_result_t<TKeySelector, reference>>, std::decay_t<std::invoke_result_t<TElementSelector, reference>>, THash>;
+
     template<class THash>
     Enumerable UnionHash(const Enumerable& other) &&;
 
     template<class THash>
     Enumerable UnionHash(const Enumerable& other) const &;
 
+    //! Produces the set union of two sequences by using THash, with a table sized for expectedCount distinct elements from the start.
+    //!
+    //! @tparam THash The hash function of the elements.
+    //!
+    //! @param other An Enumerable<T> whose distinct elements form the second set for the union.
+    //! @param expectedCount The number of distinct elements expected in both sequences together.
+    //!
+    //! @returns An Enumerable<T> that contains the elements from both input sequences, excluding duplicates.
+    template<class THash>
+    Enumerable UnionHash(const Enumerable& other, ExpectedCount expectedCount) &&;
+
+    template<class THash>
+    Enumerable UnionHash(const Enumerable& other, ExpectedCount expectedCount) const &;
+
     template<class TLess>
     Enumerable UnionLess(const Enumerable& other) &&;
 
@@ -1162,6 +2252,31 @@ public:
     template<class TEqual>
     Enumerable UnionEqual(const Enumerable& other) const &;
 
+    //! Produces the set union of two sequences of integers by building a compressed bitmap of each and merging them word by word.
+    //!
+    //! @param other The second sequence. Pass an rvalue to stream it rather than materialize it.
+    //!
+    //! @returns The distinct elements of both sequences, in ascending order.
+    Enumerable UnionBitmap(Enumerable other) &&;
+
+    Enumerable UnionBitmap(Enumerable other) const &;
+
+    //! Produces the set union of two sequences that are both sorted by TLess by merging them in a single pass, holding no more than one
+    //! element in memory.
+    //!
+    //! @tparam TLess The comparer both sequences are sorted by in ascending order.
+    //!
+    //! @param other The second sequence. Pass an rvalue to stream it rather than materialize it.
+    //!
+    //! @returns The distinct elements of both sequences, sorted by TLess.
+    //!
+    //! @note Union never picks this by itself, since it yields elements in order of first appearance rather than merged.
+    template<class TLess = std::less<T>>
+    Enumerable UnionSorted(Enumerable other) &&;
+
+    template<class TLess = std::less<T>>
+    Enumerable UnionSorted(Enumerable other) const &;
+
     //! Produces the set union of two sequences by using the default equality comparer.
     //!
     //! @param other An Enumerable<T> whose distinct elements form the second set for the union.
@@ -1188,6 +2303,109 @@ public:
     template<class TPredicate>
     Enumerable Where(TPredicate predicate) const &;
 
+    //! Filters a sequence down to the elements whose key is among the keys of another sequence, i.e. a semi-join. The keys of inner
+    //! are collected once; the elements are then filtered as they come, keep their order, and come at most once each however many inner
+    //! elements share their key. The default equality comparer is used to compare keys.
+    //!
+    //! @tparam TInner The type of the elements of the second sequence. Value type of TEnumerable.
+    //! @tparam TKey The type of the keys returned by the key selector functions. Return type of TKeySelector and TInnerKeySelector.
+    //!
+    //! @tparam TEnumerable The type of the sequence whose keys are looked up.
+    //! @tparam TKeySelector function<TKey(const T&)>.
+    //! @tparam TInnerKeySelector function<TKey(const TInner&)>. Pass std::identity{} if inner holds the keys themselves.
+    //!
+    //! @param inner The sequence whose keys are looked up.
+    //! @param keySelector A function to extract the key from each element.
+    //! @param innerKeySelector A function to extract the key from each element of the second sequence.
+    //!
+    //! @returns An Enumerable<T> that contains the elements that have a matching element in inner.
+    template<class TEnumerable, class TKeySelector, class TInnerKeySelector>
+    Enumerable WhereIn(const TEnumerable& inner, TKeySelector keySelector, TInnerKeySelector innerKeySelector) &&;
+
+    template<class TEnumerable, class TKeySelector, class TInnerKeySelector>
+    Enumerable WhereIn(const TEnumerable& inner, TKeySelector keySelector, TInnerKeySelector innerKeySelector) const &;
+
+    template<class TKey, class TElement, class THash, class TKeySelector>
+    Enumerable WhereIn(Lookup<TKey, TElement, THash> inner, TKeySelector keySelector) &&;
+
+    template<class TKey, class TElement, class THash, class TKeySelector>
+    Enumerable WhereIn(Lookup<TKey, TElement, THash> inner, TKeySelector keySelector) const &;
+
+    template<class THash, class TEnumerable, class TKeySelector, class TInnerKeySelector>
+    Enumerable WhereInHash(const TEnumerable& inner, TKeySelector keySelector, TInnerKeySelector innerKeySelector) &&;
+
+    template<class THash, class TEnumerable, class TKeySelector, class TInnerKeySelector>
+    Enumerable WhereInHash(const TEnumerable& inner, TKeySelector keySelector, TInnerKeySelector innerKeySelector) const &;
+
+    template<class TLess, class TEnumerable, class TKeySelector, class TInnerKeySelector>
+    Enumerable WhereInLess(const TEnumerable& inner, TKeySelector keySelector, TInnerKeySelector innerKeySelector) &&;
+
+    template<class TLess, class TEnumerable, class TKeySelector, class TInnerKeySelector>
+    Enumerable WhereInLess(const TEnumerable& inner, TKeySelector keySelector, TInnerKeySelector innerKeySelector) const &;
+
+    //! Filters a sequence down to the elements that may have a match in a join with another sequence, without holding the other sequence
+    //! in memory. The keys of inner are summarized in a Bloom filter of 2 bytes per key: no element with a matching key is dropped, and
+    //! about one in 1000 elements without one is kept. Put it in front of expensive projections of the first sequence of a selective join.
+    //!
+    //! @tparam TInner The type of the elements of the second sequence. Value type of TEnumerable.
+    //! @tparam TKey The type of the keys returned by the key selector functions. Return type of TKeySelector and TInnerKeySelector.
+    //!
+    //! @tparam THash The hash function of the keys.
+    //! @tparam TEnumerable The type of the sequence that the elements will be joined to.
+    //! @tparam TKeySelector function<TKey(const T&)>.
+    //! @tparam TInnerKeySelector function<TKey(const TInner&)>.
+    //!
+    //! @param inner The sequence that the elements will be joined to.
+    //! @param keySelector A function to extract the join key from each element.
+    //! @param innerKeySelector A function to extract the join key from each element of the second sequence.
+    //!
+    //! @returns An Enumerable<T> that contains the elements whose key may be among the keys of inner, in their original order.
+    template<class THash, class TEnumerable, class TKeySelector, class TInnerKeySelector>
+    Enumerable WhereMayJoin(const TEnumerable& inner, TKeySelector keySelector, TInnerKeySelector innerKeySelector) &&;
+
+    template<class THash, class TEnumerable, class TKeySelector, class TInnerKeySelector>
+    Enumerable WhereMayJoin(const TEnumerable& inner, TKeySelector keySelector, TInnerKeySelector innerKeySelector) const &;
+
+    //! Filters a sequence down to the elements whose key is not among the keys of another sequence, i.e. an anti-join. The keys of inner
+    //! are collected once; the elements are then filtered as they come, keep their order, and come at most once each however many inner
+    //! elements share their key. The default equality comparer is used to compare keys.
+    //!
+    //! @tparam TInner The type of the elements of the second sequence. Value type of TEnumerable.
+    //! @tparam TKey The type of the keys returned by the key selector functions. Return type of TKeySelector and TInnerKeySelector.
+    //!
+    //! @tparam TEnumerable The type of the sequence whose keys are looked up.
+    //! @tparam TKeySelector function<TKey(const T&)>.
+    //! @tparam TInnerKeySelector function<TKey(const TInner&)>. Pass std::identity{} if inner holds the keys themselves.
+    //!
+    //! @param inner The sequence whose keys are looked up.
+    //! @param keySelector A function to extract the key from each element.
+    //! @param innerKeySelector A function to extract the key from each element of the second sequence.
+    //!
+    //! @returns An Enumerable<T> that contains the elements that have no matching element in inner.
+    template<class TEnumerable, class TKeySelector, class TInnerKeySelector>
+    Enumerable WhereNotIn(const TEnumerable& inner, TKeySelector keySelector, TInnerKeySelector innerKeySelector) &&;
+
+    template<class TEnumerable, class TKeySelector, class TInnerKeySelector>
+    Enumerable WhereNotIn(const TEnumerable& inner, TKeySelector keySelector, TInnerKeySelector innerKeySelector) const &;
+
+    template<class TKey, class TElement, class THash, class TKeySelector>
+    Enumerable WhereNotIn(Lookup<TKey, TElement, THash> inner, TKeySelector keySelector) &&;
+
+    template<class TKey, class TElement, class THash, class TKeySelector>
+    Enumerable WhereNotIn(Lookup<TKey, TElement, THash> inner, TKeySelector keySelector) const &;
+
+    template<class THash, class TEnumerable, class TKeySelector, class TInnerKeySelector>
+    Enumerable WhereNotInHash(const TEnumerable& inner, TKeySelector keySelector, TInnerKeySelector innerKeySelector) &&;
+
+    template<class THash, class TEnumerable, class TKeySelector, class TInnerKeySelector>
+    Enumerable WhereNotInHash(const TEnumerable& inner, TKeySelector keySelector, TInnerKeySelector innerKeySelector) const &;
+
+    template<class TLess, class TEnumerable, class TKeySelector, class TInnerKeySelector>
+    Enumerable WhereNotInLess(const TEnumerable& inner, TKeySelector keySelector, TInnerKeySelector innerKeySelector) &&;
+
+    template<class TLess, class TEnumerable, class TKeySelector, class TInnerKeySelector>
+    Enumerable WhereNotInLess(const TEnumerable& inner, TKeySelector keySelector, TInnerKeySelector innerKeySelector) const &;
+
     //! Filters a sequence of values based on a predicate. Each element's index is used in the logic of the predicate function.
     //!
     //! @tparam TPredicate function<bool(const T&, int)>.
@@ -1267,19 +2485,120 @@ public:
     // ThenBy
     // ThenByDescending
     // ToArray
-    // ToDictionary
-    // ToHashSet
     // ToList
-    // ToLookup
 
 #pragma endregion todo
 
 private:
+    template<class U>
+    friend class Enumerable;
+
     class Controller;
 
     Enumerable(promise_type& promise);
 
+    explicit Enumerable(Controller controller, const std::type_info* orderedBy = nullptr);
+
+    // Elements [begin, end) of storage, which is shared rather than copied.
+    static Enumerable View(std::shared_ptr<const Container> storage, size_type begin, size_type end);
+
+    // One view per group of rows, where groups[i] is the group of rows[i], below count. The views share a single buffer.
+    static std::vector<Enumerable> Views(Container rows, std::vector<size_type> groups, size_type count);
+
+    // Resolves BuildSide::Auto for a hash join with inner, see BuildSide.
+    template<class TEnumerable>
+    BuildSide ChooseBuildSide(const TEnumerable& inner, BuildSide side) const;
+
+    // Builds a Bitmap of each sequence, applies operation(lhs, rhs) to them and yields the values left in lhs in ascending order.
+    template<class TOperation>
+    Enumerable CombineBitmaps(Enumerable other, TOperation operation, const char* name) &&;
+
+    template<class THash>
+    Enumerable DistinctHashImpl(std::optional<size_type> expectedCount) &&;
+
+    template<class THash, class TSerializer>
+    Enumerable DistinctHashImpl(size_type memoryBudget, std::size_t depth) &&;
+
+    template<class TLess>
+    Enumerable ExceptSortedImpl(Enumerable other) &&;
+
+    template<class THash, class TKeySelector, class TElementSelector, class TResultSelector>
+    auto GroupByHashImpl(
+        TKeySelector keySelector,
+        TElementSelector elementSelector,
+        TResultSelector resultSelector,
+        std::optional<size_type> expectedCount) && -> Enumerable<std::invoke_result_t<TResultSelector, std::invoke_result_t<TKeySelector, reference>, Enumerable<std::invoke_result_t<TElementSelector, reference>>>>;
+
+    template<class THash, class TSerializer, class TKeySelector, class TElementSelector, class TResultSelector>
+    auto GroupByHashImpl(
+        TKeySelector keySelector,
+        TElementSelector elementSelector,
+        TResultSelector resultSelector,
+        size_type memoryBudget,
+        std::size_t depth) && -> Enumerable<std::invoke_result_t<TResultSelector, std::invoke_result_t<TKeySelector, reference>, Enumerable<std::invoke_result_t<TElementSelector, reference>>>>;
+
+    template<class THash, class TSerializer, class TInnerSerializer, class TInner, class TOuterKeySelector, class TInnerKeySelector, class TResultSelector>
+    auto GroupJoinHashImpl(
+        Enumerable<TInner> inner,
+        TOuterKeySelector outerKeySelector,
+        TInnerKeySelector innerKeySelector,
+        TResultSelector resultSelector,
+        size_type memoryBudget,
+        std::size_t depth) && -> Enumerable<std::invoke_result_t<TResultSelector, reference, const Enumerable<TInner>&>>;
+
+    template<class TLess>
+    Enumerable IntersectSortedImpl(Enumerable other) &&;
+
+    // Whether the elements are known to be sorted as by OrderBy(keySelector, comparer).
+    template<class TKeySelector, class TComparer>
+    bool IsOrderedBy() const noexcept;
+
+    template<class THash, class TSerializer, class TInnerSerializer, class TInner, class TOuterKeySelector, class TInnerKeySelector, class TResultSelector>
+    auto JoinHashImpl(
+        Enumerable<TInner> inner,
+        TOuterKeySelector outerKeySelector,
+        TInnerKeySelector innerKeySelector,
+        TResultSelector resultSelector,
+        size_type memoryBudget,
+        std::size_t depth) && -> Enumerable<std::invoke_result_t<TResultSelector, reference, const TInner&>>;
+
+    template<class TKeySelector, class TComparer>
+    static Enumerable MergeSortedImpl(std::vector<Enumerable> sources, TKeySelector keySelector, TComparer comparer);
+
+    template<class TSerializer, class TKeySelector, class TComparer>
+    Enumerable OrderByExternalImpl(TKeySelector keySelector, TComparer comparer, size_type memoryBudget) &&;
+
+    // Pairs each element with the number of its key in index, or with nothing if the key isn't there or filter (an optional Bloom filter
+    // of the keys) rules it out. Elements held in memory are looked up in batches whose cache misses overlap, see
+    // detail::KeyIndex::PrefetchSlot.
+    template<class TKeyIndex, class TKeySelector, class TFilter>
+    auto Probe(const TKeyIndex& index, TKeySelector keySelector, const TFilter& filter) &&
+        -> Enumerable<std::pair<const value_type*, std::optional<std::size_t>>>;
+
+    // The number of elements, if it is known without running the sequence.
+    std::optional<size_type> SizeHint() const;
+
+    Enumerable SkipImpl(int count) &&;
+
+    Enumerable TakeImpl(int count) &&;
+
+    template<class THash>
+    Enumerable UnionHashImpl(Enumerable other, std::optional<size_type> expectedCount) &&;
+
+    template<class TLess>
+    Enumerable UnionSortedImpl(Enumerable other) &&;
+
+    // At most how many elements there are, if that is known without running the sequence.
+    std::optional<size_type> UpperBound() const;
+
+    // Collects the inner keys in a TSet and keeps the elements whose key is among them if in is true, or the others if it is false.
+    template<class TSet, class TEnumerable, class TKeySelector, class TInnerKeySelector>
+    Enumerable WhereInImpl(const TEnumerable& inner, TKeySelector keySelector, TInnerKeySelector innerKeySelector, bool in) &&;
+
     Controller controller_{};
+
+    // The ordering the elements are known to be sorted by, if any. See detail::OrderTag.
+    const std::type_info* orderedBy_{};
 }; // class Enumerable
 
 #pragma region ctad
@@ -1313,6 +2632,96 @@ Grouping(TKey, const TEnumerable& enumerable) -> Grouping<TKey, std::decay_t<dec
 
 #pragma endregion Grouping
 
+#pragma region Lookup
+
+//! A collection of keys each mapped to one or more values, built once from a sequence. Copies share the same immutable groups, so a Lookup
+//! built from a reference table can be passed to any number of Join, GroupJoin, WhereIn and WhereNotIn calls, none of which then builds
+//! a hash table of its own.
+//!
+//! @tparam TKey The type of the keys.
+//! @tparam TElement The type of the elements of each value collection.
+//! @tparam THash The hash function of the keys.
+//!
+//! @see https://docs.microsoft.com/en-us/dotnet/api/system.linq.lookup-2?view=net-5.0
+template<class TKey, class TElement, class THash>
+class Lookup {
+public:
+    using key_type = TKey;
+    using size_type = std::size_t;
+
+    //! Creates an empty Lookup.
+    Lookup();
+
+    //! Groups the elements of a sequence by key.
+    //!
+    //! @tparam TSource The type of the elements of source.
+    //! @tparam TKeySelector function<TKey(const TSource&)>.
+    //! @tparam TElementSelector function<TElement(const TSource&)>.
+    //!
+    //! @param source The sequence to group. Pass an rvalue to stream it rather than materialize it.
+    //! @param keySelector A function to extract a key from each element.
+    //! @param elementSelector A transform function to produce a result element value from each element.
+    template<class TSource, class TKeySelector, class TElementSelector>
+    Lookup(Enumerable<TSource> source, TKeySelector keySelector, TElementSelector elementSelector);
+
+    //! Determines whether a specified key is in the Lookup.
+    //!
+    //! @tparam U The type of key. If THash is transparent, as Hash is for strings, any type comparable with TKey is looked up without
+    //! converting it to TKey, e.g. a std::string_view in a Lookup of std::string.
+    template<class U = TKey>
+    bool Contains(const U& key) const;
+
+    //! Gets the number of keys in the Lookup.
+    size_type Count() const noexcept;
+
+    //! Gets the elements that have the specified key, in the order of the source sequence; none if the key isn't in the Lookup.
+    template<class U = TKey>
+    const std::vector<TElement>& operator[](const U& key) const;
+
+    //! Returns the groupings of the Lookup, in the order their keys first appear in the source sequence.
+    Enumerable<Grouping<TKey, TElement>> AsEnumerable() const;
+
+    //! Returns a Lookup with the same groups, indexed by a minimal perfect hash of the keys instead of a hash table. Building takes longer,
+    //! but the index is about a byte per key and finding a key reads one pilot and one slot, with no collision chains. Meant for reference
+    //! data that is built once and probed many times. If THash maps two different keys to the same value, returns this Lookup as it is.
+    Lookup Freeze() const;
+
+    //! Writes the frozen form of the Lookup to a file, so that Read can load it without building the index again. Keys and elements are
+    //! written with Serializer, along with a digest of the hashes of the keys that lets Read check THash.
+    //!
+    //! @param file The file to write to.
+    //!
+    //! @throws std::runtime_error The Lookup can't be frozen (see Freeze), or writing fails.
+    void Write(std::FILE* file) const;
+
+    //! Reads a Lookup written by Write. THash must hash the keys the same way it did in the writing process; Read checks this against the
+    //! digest in the file, since the perfect hash would otherwise send every probe to the wrong slot. The counts in the file are
+    //! checked against its size, or, if it can't seek, against the data actually read, so a malformed file can't make Read allocate more
+    //! than the file holds.
+    //!
+    //! @param file The file to read from.
+    //!
+    //! @throws std::runtime_error The file doesn't hold a Lookup, holds one in another format version, was written with a different hash
+    //! function, or is truncated or malformed.
+    static Lookup Read(std::FILE* file);
+
+private:
+    template<class U>
+    friend class Enumerable;
+
+    struct State;
+
+    static Enumerable<Grouping<TKey, TElement>> AsEnumerableImpl(std::shared_ptr<const State> state);
+
+    // The elements that have key, sharing ownership of the Lookup rather than copying them.
+    template<class U>
+    std::shared_ptr<const std::vector<TElement>> Share(const U& key) const;
+
+    std::shared_ptr<const State> state_;
+}; // class Lookup
+
+#pragma endregion Lookup
+
 } // namespace cpplinq
 
 #include "Enumerable.iterator.h"
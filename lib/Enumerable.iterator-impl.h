@@ -16,6 +16,7 @@ template<class T>
 class CoroutineIterator : public Iterator<T> {
 public:
     explicit CoroutineIterator(typename Enumerable<T>::Coroutine coroutine) : coroutine_{coroutine} {
+        coroutine_.promise().Rethrow();
     }
 
     bool HasNext() const override {
@@ -24,6 +25,7 @@ public:
 
     void Next() override {
         coroutine_();
+        coroutine_.promise().Rethrow();
     }
 
     const T& Value() const override {
@@ -37,7 +39,11 @@ private:
 template<class T>
 class ContainerIterator : public Iterator<T> {
 public:
-    explicit ContainerIterator(const typename Enumerable<T>::Container& container) : begin_{std::begin(container)}, end_{std::end(container)} {
+    explicit ContainerIterator(const typename Enumerable<T>::Container& container) : ContainerIterator{std::begin(container), std::end(container)} {
+    }
+
+    ContainerIterator(typename Enumerable<T>::Container::const_iterator begin, typename Enumerable<T>::Container::const_iterator end)
+        : begin_{begin}, end_{end} {
     }
 
     bool HasNext() const override {
@@ -60,10 +66,17 @@ private:
 
 template<class T>
 Enumerable<T>::iterator::iterator(const Controller& controller) : controller_{controller} {
+    if (controller_.IsOrdered()) {
+        if (controller_.GetOrdered().take == detail::kUnbounded) {
+            controller_ = controller_.GetOrdered().SortIncrementally();
+        } else {
+            controller_.Flush();
+        }
+    }
     if (controller_.IsCoroutine()) {
         impl_ = std::make_unique<detail::CoroutineIterator<T>>(controller_.GetCoroutine());
-    } else if (controller_.IsContainer()) {
-        impl_ = std::make_unique<detail::ContainerIterator<T>>(controller_.GetContainer());
+    } else if (controller_.IsMaterialized()) {
+        impl_ = MakeContainerIterator(controller_);
     } else {
         controller_.Reset();
     }
@@ -79,8 +92,8 @@ auto Enumerable<T>::iterator::operator=(const iterator& rhs) -> iterator& {
     if (this != &rhs) {
         controller_ = rhs.controller_;
         controller_.Flush();
-        if (controller_.IsContainer()) {
-            impl_ = std::make_unique<detail::ContainerIterator<T>>(controller_.GetContainer());
+        if (controller_.IsMaterialized()) {
+            impl_ = MakeContainerIterator(controller_);
         } else {
             controller_.Reset();
             impl_.reset();
@@ -89,6 +102,16 @@ auto Enumerable<T>::iterator::operator=(const iterator& rhs) -> iterator& {
     return *this;
 }
 
+template<class T>
+auto Enumerable<T>::iterator::MakeContainerIterator(const Controller& controller) -> std::unique_ptr<detail::Iterator<T>> {
+    if (controller.IsSlice()) {
+        auto&& slice = controller.GetSlice();
+        auto begin = std::begin(*slice.storage);
+        return std::make_unique<detail::ContainerIterator<T>>(begin + slice.begin, begin + slice.end);
+    }
+    return std::make_unique<detail::ContainerIterator<T>>(controller.GetContainer());
+}
+
 template<class T>
 bool Enumerable<T>::iterator::operator!=(const iterator& rhs) const {
     return !rhs.controller_ && impl_ && impl_->HasNext();
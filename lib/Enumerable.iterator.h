@@ -32,6 +32,9 @@ public:
     reference operator*() const;
 
 private:
+    // Iterates a container or a slice of one.
+    static std::unique_ptr<detail::Iterator<T>> MakeContainerIterator(const Controller& controller);
+
     Controller controller_{};
     std::unique_ptr<detail::Iterator<T>> impl_{};
 }; // class Enumerable::iterator
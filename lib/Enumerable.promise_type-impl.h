@@ -16,8 +16,8 @@ constexpr void Enumerable<T>::promise_type::return_void() noexcept {
 }
 
 template<class T>
-void Enumerable<T>::promise_type::unhandled_exception() {
-    throw;
+void Enumerable<T>::promise_type::unhandled_exception() noexcept {
+    exception_ = std::current_exception();
 }
 
 template<class T>
@@ -35,4 +35,11 @@ template<class T>
 auto Enumerable<T>::promise_type::operator*() const -> reference {
     return *value_;
 }
+
+template<class T>
+void Enumerable<T>::promise_type::Rethrow() const {
+    if (exception_) {
+        std::rethrow_exception(exception_);
+    }
+}
 } // namespace cpplinq
@@ -7,15 +7,20 @@ public:
     static constexpr std::suspend_never initial_suspend() noexcept;
     static constexpr std::suspend_always final_suspend() noexcept;
     static constexpr void return_void() noexcept;
-    static void unhandled_exception();
+    void unhandled_exception() noexcept;
     Enumerable get_return_object();
     std::suspend_always yield_value(T value);
 
     reference operator*() const;
 
+    //! Rethrows the exception the coroutine ended with, if any. Exceptions are kept in the promise rather than thrown out of the coroutine,
+    //! because a coroutine starts eagerly and an exception thrown before its first co_yield would destroy the frame its Enumerable still owns.
+    void Rethrow() const;
+
     void await_transform() = delete;
 
 private:
     std::optional<T> value_{};
+    std::exception_ptr exception_{};
 }; /// class Enumerable::promise_type
 } // namespace cpplinq
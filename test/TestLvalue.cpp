@@ -258,6 +258,23 @@ void TestDistinct() {
         //     55
         //     17
     }
+    {
+        // Keeps at most two ages in memory, the others are spilled to temporary files.
+        Enumerable ages{21, 46, 46, 55, 17, 21, 55, 55};
+        auto distinctAges = ages.DistinctHash<std::hash<int>>(2 * sizeof(int));
+        auto sortedAges = distinctAges.OrderBy();
+
+        std::cout << "Distinct ages:" << std::endl;
+        for (auto&& age : sortedAges) {
+            std::cout << age << std::endl;
+        }
+        // output:
+        //     Distinct ages:
+        //     17
+        //     21
+        //     46
+        //     55
+    }
     {
         struct Product {
             std::string Name;
@@ -779,6 +796,19 @@ void TestIntersect() {
         //     26
         //     30
     }
+    {
+        std::set<int> lhs{44, 26, 92, 30, 71, 38};
+        std::set<int> rhs{39, 59, 83, 47, 26, 4, 30};
+        Enumerable<int> ids{lhs};
+        auto both = ids.IntersectSorted(rhs);
+
+        for (auto&& id : both) {
+            std::cout << id << std::endl;
+        }
+        // output:
+        //     26
+        //     30
+    }
     {
         struct Product {
             std::string Name;
@@ -1053,6 +1083,55 @@ void TestOrderBy() {
         //     Boots - 4
         //     Whiskers - 1
     }
+    {
+        struct LogEntry {
+            int Time;
+            std::string Message;
+        };
+
+        auto byTime = [] (const LogEntry& entry) { return entry.Time; };
+
+        // Two logs that are each already in time order, so sorting only has to merge them.
+        // Sorting the result by time again is free.
+        Enumerable<LogEntry> system{{1, "boot"}, {4, "login"}, {9, "logout"}};
+        Enumerable<LogEntry> storage{{2, "disk check"}, {5, "backup"}};
+        auto merged = system.Concat(storage);
+        auto query1 = merged.OrderBy(byTime);
+        auto query2 = query1.OrderBy(byTime);
+
+        for (auto&& entry : query2) {
+            std::cout << entry.Time << " " << entry.Message << std::endl;
+        }
+        // output:
+        //     1 boot
+        //     2 disk check
+        //     4 login
+        //     5 backup
+        //     9 logout
+    }
+}
+
+void TestOrderByExternal() {
+    {
+        struct Sale {
+            int Id;
+            double Amount;
+        };
+
+        // Sorts at most two sales in memory at a time, the rest is spilled to temporary files.
+        Enumerable<Sale> sales{{1, 25.5}, {2, 12.0}, {3, 99.9}, {4, 12.0}, {5, 40.0}};
+        auto query = sales.OrderByExternal([] (const Sale& sale) { return sale.Amount; }, 2 * sizeof(Sale));
+
+        for (auto&& sale : query) {
+            std::cout << sale.Id << " - " << sale.Amount << std::endl;
+        }
+        // output:
+        //     2 - 12
+        //     4 - 12
+        //     1 - 25.5
+        //     5 - 40
+        //     3 - 99.9
+    }
 }
 
 void TestReverse() {
@@ -1395,6 +1474,25 @@ void TestTake() {
         // output:
         //     3
     }
+    {
+        struct Player {
+            std::string Name;
+            int Score;
+        };
+
+        // Show the second page of the leaderboard, two players per page.
+        Enumerable<Player> players{{"Ann", 90}, {"Bob", 75}, {"Cid", 90}, {"Dee", 60}, {"Eve", 75}, {"Fay", 85}};
+        auto query1 = players.OrderByDescending([] (const Player& player) { return player.Score; });
+        auto query2 = query1.Skip(2);
+        auto page = query2.Take(2);
+
+        for (auto&& player : page) {
+            std::cout << player.Name << " - " << player.Score << std::endl;
+        }
+        // output:
+        //     Fay - 85
+        //     Bob - 75
+    }
 }
 
 void TestTakeLast() {
@@ -1589,6 +1687,7 @@ void TestLvalue() {
     TestJoin();
     TestLast();
     TestOrderBy();
+    TestOrderByExternal();
     TestReverse();
     TestSelect();
     TestSelectMany();
@@ -37,6 +37,27 @@ void TestAggregate() {
     }
 }
 
+void TestAggregateBy() {
+    {
+        using Employee = std::pair<std::string, int>;
+
+        // Only one accumulator per department is held, not the employees of each department.
+        auto totals = Enumerable<Employee>{{"Sales", 3}, {"Engineering", 5}, {"Sales", 4}, {"Support", 1}, {"Engineering", 2}}
+            .AggregateBy(
+                [] (const Employee& employee) { return employee.first; },
+                std::string{},
+                [] (std::string levels, const Employee& employee) { return levels + std::to_string(employee.second); });
+
+        for (auto&& [department, levels] : totals) {
+            std::cout << department << ": " << levels << std::endl;
+        }
+        // output:
+        //     Sales: 34
+        //     Engineering: 52
+        //     Support: 1
+    }
+}
+
 void TestAll() {
     {
         struct Pet {
@@ -156,6 +177,60 @@ void TestAppend() {
     }
 }
 
+void TestAsOfJoin() {
+    {
+        struct Quote {
+            int Time;
+            std::string Symbol;
+            double Bid;
+        };
+
+        struct Trade {
+            int Time;
+            std::string Symbol;
+            int Quantity;
+        };
+
+        // Each trade is priced at the latest quote of its symbol at or before the trade; the first AAPL trade has no quote yet.
+        auto query = Enumerable<Trade>{{1, "AAPL", 100}, {3, "MSFT", 50}, {5, "AAPL", 20}, {6, "MSFT", 10}, {9, "AAPL", 70}}
+            .AsOfJoin(
+                Enumerable<Quote>{{2, "AAPL", 150.0}, {2, "MSFT", 300.5}, {5, "AAPL", 151.5}, {7, "MSFT", 299.0}, {8, "AAPL", 149.0}},
+                [] (const Trade& trade) { return trade.Symbol; },
+                [] (const Quote& quote) { return quote.Symbol; },
+                [] (const Trade& trade) { return trade.Time; },
+                [] (const Quote& quote) { return quote.Time; },
+                [] (const Trade& trade, const Quote& quote) {
+                    return std::to_string(trade.Time) + ' ' + trade.Symbol + ' ' + std::to_string(trade.Quantity) + " @ " + std::to_string(quote.Bid);
+                });
+
+        for (auto&& line : query) {
+            std::cout << line << std::endl;
+        }
+        // output:
+        //     3 MSFT 50 @ 300.500000
+        //     5 AAPL 20 @ 151.500000
+        //     6 MSFT 10 @ 300.500000
+        //     9 AAPL 70 @ 149.000000
+    }
+    {
+        // The reading in effect at each sampling time.
+        auto query = Enumerable{0, 10, 20, 30}
+            .AsOfJoin(
+                Enumerable<std::pair<int, int>>{{5, 21}, {12, 22}, {18, 24}, {30, 23}},
+                [] (int time) { return time; },
+                [] (const std::pair<int, int>& reading) { return reading.first; },
+                [] (int time, const std::pair<int, int>& reading) { return std::to_string(time) + ": " + std::to_string(reading.second); });
+
+        for (auto&& line : query) {
+            std::cout << line << std::endl;
+        }
+        // output:
+        //     10: 21
+        //     20: 24
+        //     30: 23
+    }
+}
+
 void TestConcat() {
     {
         struct Pet {
@@ -244,6 +319,21 @@ void TestCount() {
     }
 }
 
+void TestCountBy() {
+    {
+        auto counts = Enumerable<std::string>{"apple", "avocado", "banana", "blueberry", "cherry", "apricot"}
+            .CountBy([] (const std::string& fruit) { return fruit.front(); });
+
+        for (auto&& [letter, count] : counts) {
+            std::cout << letter << ": " << count << std::endl;
+        }
+        // output:
+        //     a: 3
+        //     b: 2
+        //     c: 1
+    }
+}
+
 void TestDefaultIfEmpty() {
     {
         struct Pet {
@@ -284,6 +374,17 @@ void TestDistinct() {
         //     55
         //     17
     }
+    {
+        // Few distinct keys are found by a linear scan, many by a hash table; both keep the order of first appearance.
+        auto few = Enumerable<int>::Range(0, 1000).Select([] (int x) { return x % 7; }).Distinct();
+        auto many = Enumerable<int>::Range(0, 1000).Select([] (int x) { return 999 - x % 500; }).Distinct();
+
+        std::cout << few.Count() << " " << few.First(-1) << " " << few.Last(-1) << std::endl;
+        std::cout << many.Count() << " " << many.First(-1) << " " << many.Last(-1) << std::endl;
+        // output:
+        //     7 0 6
+        //     500 999 500
+    }
     {
         struct Product {
             std::string Name;
@@ -329,6 +430,56 @@ void TestDistinct() {
         //     55
         //     17
     }
+    {
+        // Keeps at most two ages in memory, the others are spilled to temporary files.
+        auto distinctAges = Enumerable{21, 46, 46, 55, 17, 21, 55, 55}
+            .DistinctHash<std::hash<int>>(2 * sizeof(int))
+            .OrderBy();
+
+        std::cout << "Distinct ages:" << std::endl;
+        for (auto&& age : distinctAges) {
+            std::cout << age << std::endl;
+        }
+        // output:
+        //     Distinct ages:
+        //     17
+        //     21
+        //     46
+        //     55
+    }
+    {
+        std::vector<std::string> visits{};
+        for (int i = 0; i < 100000; ++i) {
+            visits.push_back("user" + std::to_string(i * 7 % 2500));
+        }
+
+        // The number of visits is known, so the table is sized for the users seen in the first few thousand visits.
+        auto users = Enumerable<std::string>{visits}.DistinctHash<cpplinq::Hash<std::string>>().Count();
+        // A caller who knows how many users there are has the table sized once up front.
+        auto expected = Enumerable<std::string>{visits}.DistinctHash<cpplinq::Hash<std::string>>(cpplinq::ExpectedCount{2500}).Count();
+
+        std::cout << users << ' ' << expected << std::endl;
+        // output:
+        //     2500 2500
+    }
+    {
+        cpplinq::MemoryContext context{1 << 20};
+        cpplinq::MemoryContext::Scope scope{context};
+
+        // Take bounds the number of elements but doesn't tell it, so the table isn't sized for a hundred million of them.
+        auto kept = Enumerable<int>::Range(0, 100000)
+            .Where([] (int x) { return x % 10 == 0; })
+            .OrderBy([] (int x) { return x; })
+            .Take(100000000)
+            .DistinctHash<cpplinq::Hash<int>>()
+            .Count();
+        // Nor is it sized past what the context has left, even for a caller's expected count.
+        auto expected = Enumerable<int>::Range(0, 10).DistinctHash<cpplinq::Hash<int>>(cpplinq::ExpectedCount{100000000}).Count();
+
+        std::cout << kept << ' ' << expected << std::endl;
+        // output:
+        //     10000 10
+    }
 }
 
 void TestElementAt() {
@@ -352,6 +503,15 @@ void TestElementAt() {
         // output:
         //     The name chosen at index 1000 is '<no name at this index>'
     }
+    {
+        auto median = Enumerable{59, 82, 70, 56, 92, 98, 85}
+            .OrderBy()
+            .ElementAt(3, 0);
+
+        std::cout << "The median grade is " << median << std::endl;
+        // output:
+        //     The median grade is 82
+    }
 }
 
 void TestEmpty() {
@@ -462,6 +622,15 @@ void TestFirst() {
         // output:
         //     5566
     }
+    {
+        auto highest = Enumerable{9, 34, 65, 92, 87, 435, 3, 54, 83, 23, 87, 435, 67, 12, 19}
+            .OrderByDescending()
+            .First(5566);
+
+        std::cout << highest << std::endl;
+        // output:
+        //     435
+    }
     {
         std::string names[] = {"Hartono, Tommy", "Adams, Terry", "Andersen, Henriette Thaulow", "Hedlund, Magnus", "Ito, Shu"};
 
@@ -624,6 +793,81 @@ void TestGroupBy() {
         //     Key:2 Count:2
         //     Key:3 Count:3
     }
+    {
+        // The groups are views of one buffer shared by all of them, which stays alive as long as any group does.
+        std::vector<cpplinq::Grouping<int, int>> groups{};
+        for (auto&& group : Enumerable{5, 12, 7, 14, 9}.GroupBy([] (int x) { return x % 2; }, [] (int x) { return x; })) {
+            groups.push_back(group);
+        }
+
+        for (auto&& group : groups) {
+            std::cout << group.Key() << ":";
+            for (auto x : group) {
+                std::cout << " " << x;
+            }
+            std::cout << std::endl;
+        }
+        // output:
+        //     1: 5 7 9
+        //     0: 12 14
+    }
+    {
+        using Visit = std::pair<int, std::string>;
+
+        // Holds about two visits in memory, the visits of the other users are spilled to temporary files.
+        auto query = Enumerable<Visit>{{7, "home"}, {3, "cart"}, {7, "search"}, {9, "home"}, {3, "checkout"}, {7, "cart"}}
+            .GroupByHash<std::hash<int>>(
+                [] (const Visit& visit) { return visit.first; },
+                [] (const Visit& visit) { return visit.second; },
+                [] (int userId, const Enumerable<std::string>& pages) { return std::make_pair(userId, pages.Count()); },
+                2 * sizeof(Visit))
+            .OrderBy();
+
+        for (auto&& [userId, count] : query) {
+            std::cout << "User:" << userId << " Visits:" << count << std::endl;
+        }
+        // output:
+        //     User:3 Visits:2
+        //     User:7 Visits:3
+        //     User:9 Visits:1
+    }
+    {
+        // Every buffering operator started while the scope is alive is charged to the context.
+        cpplinq::MemoryContext context{1024};
+        cpplinq::MemoryContext::Scope scope{context};
+
+        try {
+            auto groups = Enumerable<int>::Range(0, 1000).GroupBy([] (int x) { return x % 10; }, [] (int x) { return x; }).Count();
+            std::cout << "Groups:" << groups << std::endl;
+        } catch (const cpplinq::MemoryLimitExceeded& e) {
+            std::cout << e.Operator() << " needs more than " << e.Limit() << " bytes" << std::endl;
+        }
+
+        // Overloads taking a memory budget spill instead.
+        auto total = Enumerable<int>::Range(0, 1000)
+            .GroupByHash<std::hash<int>>([] (int x) { return x % 10; }, [] (int x) { return x; }, [] (int, const Enumerable<int>& elements) { return elements.Count(); }, 1 << 20)
+            .Aggregate(0, [] (int acc, int count) { return acc + count; });
+        std::cout << "Grouped:" << total << " Usage:" << context.Usage() << std::endl;
+        // output:
+        //     GroupBy needs more than 1024 bytes
+        //     Grouped:1000 Usage:0
+    }
+    {
+        cpplinq::MemoryContext context{1024};
+        cpplinq::MemoryContext::Scope scope{context};
+
+        // Hashing can't split the elements of a single key, so after the last level of spilling they are grouped in memory and charged.
+        try {
+            auto groups = Enumerable<int>::Range(0, 1000)
+                .GroupByHash<std::hash<int>>([] (int) { return 0; }, [] (int x) { return x; }, [] (int, const Enumerable<int>& elements) { return elements.Count(); }, 256)
+                .Count();
+            std::cout << "Groups:" << groups << std::endl;
+        } catch (const cpplinq::MemoryLimitExceeded& e) {
+            std::cout << e.Operator() << " needs more than " << e.Limit() << " bytes" << std::endl;
+        }
+        // output:
+        //     GroupBy needs more than 1024 bytes
+    }
 }
 
 void TestGroupJoin() {
@@ -826,6 +1070,80 @@ void TestGroupJoin() {
         //       Barley
         //       Boots
     }
+    {
+        // Outer elements with the same key share one view of their matches, which outlives the query.
+        std::vector<Enumerable<int>> matches{};
+        for (auto&& match : Enumerable{1, 2, 1, 3, 1}.GroupJoin(
+                {10, 11, 20, 12},
+                [] (int x) { return x; },
+                [] (int x) { return x / 10; },
+                [] (int, const Enumerable<int>& inner) { return inner; })) {
+            matches.push_back(match);
+        }
+
+        for (auto&& match : matches) {
+            std::cout << match.Count() << ":";
+            for (auto x : match) {
+                std::cout << " " << x;
+            }
+            std::cout << std::endl;
+        }
+        // output:
+        //     3: 10 11 12
+        //     1: 20
+        //     3: 10 11 12
+        //     0:
+        //     3: 10 11 12
+    }
+    {
+        struct Customer {
+            int Id;
+            std::string Name;
+        };
+
+        // Customers aren't trivially copyable, so spilling them takes a Serializer of their own.
+        struct CustomerSerializer {
+            static void Write(std::FILE* file, const Customer& customer) {
+                cpplinq::Serializer<int>::Write(file, customer.Id);
+                cpplinq::Serializer<std::string>::Write(file, customer.Name);
+            }
+
+            static std::optional<Customer> Read(std::FILE* file) {
+                auto id = cpplinq::Serializer<int>::Read(file);
+                if (!id) {
+                    return std::nullopt;
+                }
+                return Customer{*id, *cpplinq::Serializer<std::string>::Read(file)};
+            }
+        };
+
+        using Order = std::pair<int, int>;
+
+        std::vector<Customer> customers{{1, "Adams"}, {2, "Weiss"}, {3, "Hedlund"}, {5, "Doe"}};
+
+        // Holds about two customers in memory, the rest of them is group joined partition by partition from temporary files.
+        auto query = Enumerable<Order>{{3, 120}, {1, 40}, {4, 15}, {2, 70}}
+            .GroupJoinHash<std::hash<int>, cpplinq::Serializer<Order>, CustomerSerializer>(
+                customers,
+                [] (const Order& order) { return order.first; },
+                [] (const Customer& customer) { return customer.Id; },
+                [] (const Order& order, const Enumerable<Customer>& matches) {
+                    return std::to_string(order.second) + ":" + matches.Aggregate(std::string{}, [] (std::string names, const Customer& customer) {
+                        return std::move(names) + ' ' + customer.Name;
+                    });
+                },
+                2 * (sizeof(int) + sizeof(Customer)))
+            .OrderBy();
+
+        for (auto&& line : query) {
+            std::cout << line << std::endl;
+        }
+        // output:
+        //     120: Hedlund
+        //     15:
+        //     40: Adams
+        //     70: Weiss
+    }
 }
 
 void TestIntersect() {
@@ -839,6 +1157,25 @@ void TestIntersect() {
         //     26
         //     30
     }
+    {
+        // Integers are intersected, merged and subtracted as bitmaps, word by word; the results come out in ascending order.
+        auto evens = Enumerable<int>::Range(-10000, 20000).Where([] (int x) { return x % 2 == 0; });
+        auto threes = Enumerable<int>::Range(-10000, 20000).Where([] (int x) { return x % 3 == 0; });
+
+        auto both = evens.IntersectBitmap(threes);
+        auto either = evens.UnionBitmap(threes);
+        auto onlyEvens = evens.ExceptBitmap(threes);
+
+        std::cout << both.Count() << " " << both.First(0) << " " << both.Last(0) << std::endl;
+        std::cout << either.Count() << " " << either.First(0) << " " << either.Last(0) << std::endl;
+        std::cout << onlyEvens.Count() << " " << onlyEvens.Take(3).Aggregate(0, std::plus<>{}) << std::endl;
+        std::cout << Enumerable{7, -3, 7, 42, -3}.IntersectBitmap({42, 7, 8}).Aggregate(0, std::plus<>{}) << std::endl;
+        // output:
+        //     3333 -9996 9996
+        //     13334 -10000 9999
+        //     6667 -29992
+        //     49
+    }
     {
         struct Product {
             std::string Name;
@@ -883,6 +1220,40 @@ void TestIntersect() {
     }
 }
 
+void TestIntervalJoin() {
+    {
+        struct Session {
+            std::string User;
+            int Start;
+            int End;
+        };
+
+        struct Click {
+            int Time;
+            std::string Target;
+        };
+
+        // Attribute every click to the sessions that were open at the time; sessions may overlap.
+        auto query = Enumerable<Session>{{"ann", 0, 10}, {"bob", 5, 15}, {"cid", 20, 30}}
+            .IntervalJoin(
+                {Click{12, "buy"}, Click{3, "home"}, Click{10, "cart"}, Click{7, "search"}, Click{30, "exit"}},
+                [] (const Session& session) { return session.Start; },
+                [] (const Session& session) { return session.End; },
+                [] (const Click& click) { return click.Time; },
+                [] (const Session& session, const Click& click) { return session.User + ' ' + std::to_string(click.Time) + ' ' + click.Target; });
+
+        for (auto&& line : query) {
+            std::cout << line << std::endl;
+        }
+        // output:
+        //     ann 3 home
+        //     ann 7 search
+        //     bob 7 search
+        //     bob 10 cart
+        //     bob 12 buy
+    }
+}
+
 void TestJoin() {
     {
         struct Person {
@@ -1047,6 +1418,99 @@ void TestJoin() {
         //     Adams, Terry - Barley
         //     Adams, Terry - Boots
     }
+    {
+        using Customer = std::pair<int, std::string>;
+        using Order = std::pair<int, int>;
+
+        std::vector<Customer> customers{{1, "Adams"}, {2, "Weiss"}, {3, "Hedlund"}, {4, "Doe"}};
+
+        // Holds about two customers in memory, the rest of them is joined partition by partition from temporary files.
+        auto query = Enumerable<Order>{{3, 120}, {1, 40}, {3, 15}, {2, 70}, {5, 99}}
+            .JoinHash<std::hash<int>>(
+                customers,
+                [] (const Order& order) { return order.first; },
+                [] (const Customer& customer) { return customer.first; },
+                [] (const Order& order, const Customer& customer) { return customer.second + " - " + std::to_string(order.second); },
+                2 * (sizeof(int) + sizeof(Customer)))
+            .OrderBy();
+
+        for (auto&& line : query) {
+            std::cout << line << std::endl;
+        }
+        // output:
+        //     Adams - 40
+        //     Hedlund - 120
+        //     Hedlund - 15
+        //     Weiss - 70
+    }
+    {
+        using Customer = std::pair<int, std::string>;
+        using Order = std::pair<int, int>;
+
+        std::vector<Order> orders{{3, 120}, {1, 40}, {4, 15}, {2, 70}, {1, 99}, {3, 8}};
+
+        // The first two customers by name are known to be fewer than the orders, so the hash table is built over them and only their
+        // orders are kept.
+        auto query = Enumerable<Customer>{{1, "Adams"}, {2, "Weiss"}, {3, "Hedlund"}, {4, "Doe"}}
+            .OrderBy([] (const Customer& customer) { return customer.second; })
+            .Take(2)
+            .JoinHash<std::hash<int>>(
+                orders,
+                [] (const Customer& customer) { return customer.first; },
+                [] (const Order& order) { return order.first; },
+                [] (const Customer& customer, const Order& order) { return customer.second + " - " + std::to_string(order.second); },
+                cpplinq::BuildSide::Auto);
+
+        for (auto&& line : query) {
+            std::cout << line << std::endl;
+        }
+        // output:
+        //     Adams - 40
+        //     Adams - 99
+        //     Doe - 15
+    }
+    {
+        struct Event {
+            int Time;
+            std::string Name;
+        };
+
+        auto byTime = [] (const Event& event) { return event.Time; };
+
+        // Both streams are already ordered by time, so they are merged without building an index of either side.
+        auto query = Enumerable<Event>{{1, "open"}, {3, "click"}, {3, "scroll"}, {7, "close"}}
+            .JoinSorted(
+                Enumerable<Event>{{3, "ad"}, {5, "ad"}, {7, "survey"}},
+                byTime,
+                byTime,
+                [] (const Event& visit, const Event& popup) { return std::to_string(visit.Time) + ' ' + visit.Name + " - " + popup.Name; });
+
+        for (auto&& line : query) {
+            std::cout << line << std::endl;
+        }
+        // output:
+        //     3 click - ad
+        //     3 scroll - ad
+        //     7 close - survey
+    }
+    {
+        std::vector<int> orders{};
+        for (int i = 0; i < 100000; ++i) {
+            orders.push_back(i % 5000);
+        }
+        auto identity = [] (int id) { return id; };
+
+        // The orders are held in memory, so their keys are looked up in the table of customers a batch at a time.
+        auto count = Enumerable<int>{orders}
+            .Join(Enumerable<int>::Range(0, 1000), identity, identity, [] (int order, int) { return order; })
+            .Count();
+        auto unmatched = Enumerable<int>{orders}.Except(Enumerable<int>::Range(0, 1000)).Count();
+        auto firstMatched = Enumerable<int>{orders}.Intersect(Enumerable<int>::Range(4990, 20)).First(-1);
+
+        std::cout << count << ' ' << unmatched << ' ' << firstMatched << std::endl;
+        // output:
+        //     20000 4000 4990
+    }
 }
 
 void TestLast() {
@@ -1088,6 +1552,33 @@ void TestLast() {
     }
 }
 
+void TestMergeSorted() {
+    {
+        using Reading = std::pair<int, std::string>;
+
+        // Every sensor reports in time order, so the shards are merged rather than concatenated and sorted again.
+        auto readings = Enumerable<Reading>::MergeSorted(
+            {
+                Enumerable<Reading>{{1, "north"}, {4, "north"}, {9, "north"}},
+                Enumerable<Reading>{{2, "south"}, {4, "south"}},
+                Enumerable<Reading>{{3, "west"}, {8, "west"}},
+            },
+            [] (const Reading& reading) { return reading.first; });
+
+        for (auto&& [time, sensor] : readings) {
+            std::cout << time << ' ' << sensor << std::endl;
+        }
+        // output:
+        //     1 north
+        //     2 south
+        //     3 west
+        //     4 north
+        //     4 south
+        //     8 west
+        //     9 north
+    }
+}
+
 void TestOrderBy() {
     {
         struct Pet {
@@ -1121,6 +1612,71 @@ void TestOrderBy() {
         //     Boots - 4
         //     Whiskers - 1
     }
+    {
+        struct LogEntry {
+            int Time;
+            std::string Message;
+        };
+
+        auto byTime = [] (const LogEntry& entry) { return entry.Time; };
+
+        // Two logs that are each already in time order, so sorting only has to merge them.
+        // Sorting the result by time again is free.
+        auto query = Enumerable<LogEntry>{{1, "boot"}, {4, "login"}, {9, "logout"}}
+            .Concat(Enumerable<LogEntry>{{2, "disk check"}, {5, "backup"}})
+            .OrderBy(byTime)
+            .OrderBy(byTime);
+
+        for (auto&& entry : query) {
+            std::cout << entry.Time << " " << entry.Message << std::endl;
+        }
+        // output:
+        //     1 boot
+        //     2 disk check
+        //     4 login
+        //     5 backup
+        //     9 logout
+    }
+}
+
+void TestOrderByExternal() {
+    {
+        struct Sale {
+            int Id;
+            double Amount;
+        };
+
+        // Sorts at most two sales in memory at a time, the rest is spilled to temporary files.
+        auto query = Enumerable<Sale>{{1, 25.5}, {2, 12.0}, {3, 99.9}, {4, 12.0}, {5, 40.0}}
+            .OrderByExternal([] (const Sale& sale) { return sale.Amount; }, 2 * sizeof(Sale));
+
+        for (auto&& sale : query) {
+            std::cout << sale.Id << " - " << sale.Amount << std::endl;
+        }
+        // output:
+        //     2 - 12
+        //     4 - 12
+        //     1 - 25.5
+        //     5 - 40
+        //     3 - 99.9
+    }
+    {
+        auto query = Enumerable<std::string>{"grape", "passionfruit", "banana", "mango", "orange", "raspberry", "apple", "blueberry"}
+            .OrderByExternal([] (const std::string& fruit) { return fruit.size(); }, std::greater<std::size_t>{}, 3 * sizeof(std::string));
+
+        for (auto&& fruit : query) {
+            std::cout << fruit << std::endl;
+        }
+        // output:
+        //     passionfruit
+        //     raspberry
+        //     blueberry
+        //     banana
+        //     orange
+        //     grape
+        //     mango
+        //     apple
+    }
 }
 
 void TestPrepend() {
@@ -1527,6 +2083,25 @@ void TestSkipWhile() {
     }
 }
 
+void TestSumBy() {
+    {
+        struct Order {
+            std::string Customer;
+            double Amount;
+        };
+
+        auto sums = Enumerable<Order>{{"Contoso", 12.5}, {"Fabrikam", 3.0}, {"Contoso", 7.5}}
+            .SumBy([] (const Order& order) { return order.Customer; }, [] (const Order& order) { return order.Amount; });
+
+        for (auto&& [customer, amount] : sums) {
+            std::cout << customer << ": " << amount << std::endl;
+        }
+        // output:
+        //     Contoso: 20
+        //     Fabrikam: 3
+    }
+}
+
 void TestTake() {
     {
         auto topThreeGrades = Enumerable{59, 82, 70, 56, 92, 98, 85}
@@ -1550,6 +2125,25 @@ void TestTake() {
         // output:
         //     3
     }
+    {
+        struct Player {
+            std::string Name;
+            int Score;
+        };
+
+        // Show the second page of the leaderboard, two players per page.
+        auto page = Enumerable<Player>{{"Ann", 90}, {"Bob", 75}, {"Cid", 90}, {"Dee", 60}, {"Eve", 75}, {"Fay", 85}}
+            .OrderByDescending([] (const Player& player) { return player.Score; })
+            .Skip(2)
+            .Take(2);
+
+        for (auto&& player : page) {
+            std::cout << player.Name << " - " << player.Score << std::endl;
+        }
+        // output:
+        //     Fay - 85
+        //     Bob - 75
+    }
 }
 
 void TestTakeLast() {
@@ -1605,6 +2199,269 @@ void TestTakeWhile() {
         //     orange
         //     blueberry
     }
+    {
+        auto failingGrades = Enumerable{59, 82, 70, 56, 92, 98, 85}
+            .OrderBy()
+            .TakeWhile([] (int grade) { return grade < 60; });
+
+        for (auto&& grade : failingGrades) {
+            std::cout << grade << std::endl;
+        }
+        // output:
+        //     56
+        //     59
+    }
+}
+
+void TestToDictionary() {
+    {
+        using Package = std::pair<std::string, long>;
+
+        auto dictionary = Enumerable<Package>{
+            {"Coho Vineyard", 89453312L},
+            {"Lucerne Publishing", 89112755L},
+            {"Wingtip Toys", 299456122L},
+            {"Adventure Works", 4665518773L}}
+            .ToDictionary([] (const Package& package) { return package.second; });
+
+        for (auto trackingNumber : {89112755L, 4665518773L}) {
+            std::cout << "Key " << trackingNumber << ": " << dictionary.at(trackingNumber).first << std::endl;
+        }
+        // output:
+        //     Key 89112755: Lucerne Publishing
+        //     Key 4665518773: Adventure Works
+    }
+    {
+        using Package = std::pair<std::string, long>;
+
+        // Sorted once and appended in key order.
+        auto byCompany = Enumerable<Package>{{"Wingtip Toys", 299456122L}, {"Coho Vineyard", 89453312L}, {"Lucerne Publishing", 89112755L}}
+            .ToDictionaryLess<std::less<>>(
+                [] (const Package& package) { return package.first; },
+                [] (const Package& package) { return package.second; });
+
+        for (auto&& [company, trackingNumber] : byCompany) {
+            std::cout << company << ": " << trackingNumber << std::endl;
+        }
+        // output:
+        //     Coho Vineyard: 89453312
+        //     Lucerne Publishing: 89112755
+        //     Wingtip Toys: 299456122
+
+        try {
+            Enumerable<std::string>{"apple", "avocado"}.ToDictionary([] (const std::string& fruit) { return fruit.front(); });
+        } catch (const std::invalid_argument&) {
+            std::cout << "duplicate key" << std::endl;
+        }
+        // output:
+        //     duplicate key
+    }
+}
+
+void TestToHashSet() {
+    {
+        auto set = Enumerable<int>{5, 3, 9, 5, 3}.ToHashSet();
+
+        std::cout << set.size() << ", " << std::boolalpha << set.contains(9) << ", " << set.contains(4) << std::endl;
+        // output:
+        //     3, true, false
+    }
+    {
+        // Take only bounds the size of a filtered source, so the set is built without reserving room for the bound.
+        auto set = Enumerable<int>::Range(0, 10)
+            .Where([] (int x) { return x < 3; })
+            .OrderBy()
+            .Take(200000000)
+            .ToHashSet();
+
+        std::cout << set.size() << ", " << std::boolalpha << (set.bucket_count() < 1000) << std::endl;
+        // output:
+        //     3, true
+    }
+}
+
+void TestToLookup() {
+    {
+        struct Package {
+            std::string Company;
+            double Weight;
+            long TrackingNumber;
+        };
+
+        // Create a Lookup to organize the packages. Use the first character of Company as the key value.
+        // Select Company appended to TrackingNumber for each element value in the Lookup.
+        auto lookup = Enumerable<Package>{
+                {"Coho Vineyard", 25.2, 89453312L},
+                {"Lucerne Publishing", 18.7, 89112755L},
+                {"Wingtip Toys", 6.0, 299456122L},
+                {"Contoso Pharmaceutical", 9.3, 670053128L},
+                {"Wide World Importers", 33.8, 4665518773L}}
+            .ToLookup(
+                [] (const Package& p) { return p.Company[0]; },
+                [] (const Package& p) { return p.Company + " " + std::to_string(p.TrackingNumber); });
+
+        // Iterate through each Grouping in the Lookup and output the contents.
+        for (auto&& packageGroup : lookup.AsEnumerable()) {
+            // Print the key value of the Grouping.
+            std::cout << packageGroup.Key() << std::endl;
+            // Iterate through each value in the Grouping and print its value.
+            for (auto&& str : packageGroup) {
+                std::cout << "    " << str << std::endl;
+            }
+        }
+        // output:
+        //     C
+        //         Coho Vineyard 89453312
+        //         Contoso Pharmaceutical 670053128
+        //     L
+        //         Lucerne Publishing 89112755
+        //     W
+        //         Wingtip Toys 299456122
+        //         Wide World Importers 4665518773
+
+        // Get the number of key-collection pairs in the Lookup.
+        std::cout << lookup.Count() << std::endl;
+        // output:
+        //     3
+
+        // Select a collection of Packages by indexing directly into the Lookup.
+        for (auto&& str : lookup['C']) {
+            std::cout << str << std::endl;
+        }
+        // output:
+        //     Coho Vineyard 89453312
+        //     Contoso Pharmaceutical 670053128
+
+        // Determine if there is a key with the value 'G' in the Lookup.
+        std::cout << std::boolalpha << lookup.Contains('G') << std::endl;
+        // output:
+        //     false
+    }
+    {
+        using Customer = std::pair<int, std::string>;
+        using Order = std::pair<int, int>;
+
+        // Built once, then joined against by every query without building a hash table again.
+        auto customers = Enumerable<Customer>{{1, "Adams"}, {2, "Weiss"}, {3, "Hedlund"}}
+            .ToLookup([] (const Customer& customer) { return customer.first; });
+
+        for (auto&& orders : {Enumerable<Order>{{3, 120}, {1, 40}, {4, 15}}, Enumerable<Order>{{2, 70}, {5, 99}}}) {
+            auto query = orders.Join(
+                customers,
+                [] (const Order& order) { return order.first; },
+                [] (const Order& order, const Customer& customer) { return customer.second + " - " + std::to_string(order.second); });
+            for (auto&& line : query) {
+                std::cout << line << std::endl;
+            }
+            std::cout << "Unknown customers: " << orders.WhereNotIn(customers, [] (const Order& order) { return order.first; }).Count() << std::endl;
+        }
+        // output:
+        //     Hedlund - 120
+        //     Adams - 40
+        //     Unknown customers: 1
+        //     Weiss - 70
+        //     Unknown customers: 1
+    }
+    {
+        // Frozen once into a perfect hash index, written to a file and loaded back without building the index again.
+        auto countries = Enumerable<std::string>{"Norway", "Nepal", "Peru", "Poland", "Niger"}
+            .ToLookup([] (const std::string& country) { return country.front(); })
+            .Freeze();
+
+        auto file = std::tmpfile();
+        countries.Write(file);
+        std::rewind(file);
+        auto loaded = cpplinq::Lookup<char, std::string>::Read(file);
+        std::fclose(file);
+
+        for (auto&& group : loaded.AsEnumerable()) {
+            std::cout << group.Key() << ": " << group.Count() << std::endl;
+        }
+        std::cout << loaded['P'].back() << ", " << std::boolalpha << loaded.Contains('Q') << std::endl;
+        // output:
+        //     N: 3
+        //     P: 2
+        //     Poland, false
+    }
+    {
+        auto countries = Enumerable<std::string>{"Norway", "Nepal", "Peru", "Poland", "Niger"}
+            .ToLookup([] (const std::string& country) { return country.front(); });
+
+        // A file that isn't a Lookup, or is cut short, is rejected rather than trusted.
+        auto read = [] (const std::string& bytes) {
+            auto file = std::tmpfile();
+            std::fwrite(std::data(bytes), 1, std::size(bytes), file);
+            std::rewind(file);
+            try {
+                auto loaded = cpplinq::Lookup<char, std::string>::Read(file);
+                std::cout << "Read " << loaded.Count() << " keys" << std::endl;
+            } catch (const std::runtime_error& e) {
+                std::cout << e.what() << std::endl;
+            }
+            std::fclose(file);
+        };
+
+        auto write = [] (const auto& lookup) {
+            auto file = std::tmpfile();
+            lookup.Write(file);
+            std::string bytes(static_cast<std::size_t>(std::ftell(file)), '\0');
+            std::rewind(file);
+            std::fread(std::data(bytes), 1, std::size(bytes), file);
+            std::fclose(file);
+            return bytes;
+        };
+
+        auto bytes = write(countries);
+        read(bytes);
+        read("Norway,Nepal,Peru,Poland,Niger");
+        read(bytes.substr(0, std::size(bytes) / 2));
+
+        // Written with std::hash<char> but read with cpplinq::Hash<char>, the keys would land in the wrong slots.
+        cpplinq::Lookup<char, std::string, std::hash<char>> hashedByStd{
+            Enumerable<std::string>{"Norway", "Nepal", "Peru", "Poland", "Niger"},
+            [] (const std::string& country) { return country.front(); },
+            [] (const std::string& country) { return country; }
+        };
+        read(write(hashedByStd));
+        // output:
+        //     Read 2 keys
+        //     cpplinq: the file doesn't hold a Lookup
+        //     cpplinq: failed to read a Lookup
+        //     cpplinq: the Lookup was written with a different hash function
+    }
+    {
+        // String keys are hashed by cpplinq::Hash, which is transparent: views and literals are looked up without building a std::string.
+        auto capitals = Enumerable<std::pair<std::string, std::string>>{{"Norway", "Oslo"}, {"Peru", "Lima"}, {"Nepal", "Kathmandu"}}
+            .ToLookup([] (const auto& country) { return country.first; }, [] (const auto& country) { return country.second; });
+
+        std::string_view line{"Peru,Chile"};
+        std::cout << capitals[line.substr(0, 4)].front() << ", " << std::boolalpha << capitals.Contains("Chile") << std::endl;
+        // output:
+        //     Lima, false
+    }
+    {
+        using Order = std::pair<int, int>;
+
+        auto amounts = Enumerable<Order>{{3, 120}, {1, 40}, {3, 15}, {1, 99}}
+            .ToLookup([] (const Order& order) { return order.first; }, [] (const Order& order) { return order.second; });
+
+        // Each customer is handed a view of the group kept in the Lookup; no group is copied.
+        auto query = Enumerable{1, 2, 3, 1}.GroupJoin(
+            amounts.Freeze(),
+            [] (int customer) { return customer; },
+            [] (int customer, const Enumerable<int>& group) {
+                return std::to_string(customer) + ": " + std::to_string(group.Aggregate(0, [] (int total, int amount) { return total + amount; }));
+            });
+
+        for (auto&& line : query) {
+            std::cout << line << std::endl;
+        }
+        // output:
+        //     1: 139
+        //     2: 0
+        //     3: 135
+        //     1: 139
+    }
 }
 
 void TestUnion() {
@@ -1616,6 +2473,19 @@ void TestUnion() {
         // output:
         //     5 3 9 7 8 6 4 1 0
     }
+    {
+        // Union keeps the order of first appearance even when both sequences are sorted; UnionSorted merges them.
+        auto u = Enumerable{5, 3, 9, 7}.OrderBy().Union(Enumerable{8, 3, 6, 4, 9}.OrderBy());
+        auto merged = Enumerable{5, 3, 9, 7}.OrderBy().UnionSorted<std::less<int>>(Enumerable{8, 3, 6, 4, 9}.OrderBy());
+
+        std::copy(std::begin(u), std::end(u), std::ostream_iterator<decltype(u)::value_type>(std::cout, " "));
+        std::cout << std::endl;
+        std::copy(std::begin(merged), std::end(merged), std::ostream_iterator<decltype(merged)::value_type>(std::cout, " "));
+        std::cout << std::endl;
+        // output:
+        //     3 5 7 9 4 6 8
+        //     3 4 5 6 7 8 9
+    }
     {
         struct ProductA {
             std::string Name;
@@ -1681,6 +2551,53 @@ void TestWhere() {
         //     mango
         //     grape
     }
+    {
+        using Order = std::pair<int, int>;
+
+        std::vector<int> flaggedCustomers{3, 7};
+
+        // Orders of customers that aren't flagged are dropped before they are formatted.
+        auto query = Enumerable<Order>{{1, 120}, {3, 40}, {4, 15}, {7, 70}, {9, 99}, {3, 8}}
+            .WhereMayJoin<std::hash<int>>(
+                flaggedCustomers,
+                [] (const Order& order) { return order.first; },
+                [] (int customer) { return customer; })
+            .Select([] (const Order& order) { return std::to_string(order.first) + ": " + std::to_string(order.second); });
+
+        for (auto&& line : query) {
+            std::cout << line << std::endl;
+        }
+        // output:
+        //     3: 40
+        //     7: 70
+        //     3: 8
+    }
+    {
+        struct Pet {
+            std::string Name;
+            std::string Owner;
+        };
+
+        std::vector<Pet> pets{{"Barley", "Adams"}, {"Boots", "Adams"}, {"Whiskers", "Weiss"}, {"Daisy", "Hedlund"}};
+        Enumerable<std::string> owners{"Hedlund", "Adams", "Doe", "Weiss", "Adams"};
+
+        auto byOwner = [] (const Pet& pet) { return pet.Owner; };
+
+        // Adams owns two pets but is listed once per appearance in owners.
+        std::cout << "With pets:";
+        for (auto&& owner : owners.WhereIn(pets, std::identity{}, byOwner)) {
+            std::cout << ' ' << owner;
+        }
+        std::cout << std::endl;
+        std::cout << "Without pets:";
+        for (auto&& owner : owners.WhereNotInLess<std::less<std::string>>(pets, std::identity{}, byOwner)) {
+            std::cout << ' ' << owner;
+        }
+        std::cout << std::endl;
+        // output:
+        //     With pets: Hedlund Adams Weiss Adams
+        //     Without pets: Doe
+    }
     {
         auto query = Enumerable{0, 30, 20, 15, 90, 85, 40, 75}.WhereWithIndex([] (int number, int index) { return number <= index * 10; });
 
@@ -1727,12 +2644,15 @@ using namespace rvalue;
 
 void TestRvalue() {
     TestAggregate();
+    TestAggregateBy();
     TestAll();
     TestAny();
     TestAppend();
+    TestAsOfJoin();
     TestConcat();
     TestContains();
     TestCount();
+    TestCountBy();
     TestDefaultIfEmpty();
     TestDistinct();
     TestElementAt();
@@ -1742,9 +2662,12 @@ void TestRvalue() {
     TestGroupBy();
     TestGroupJoin();
     TestIntersect();
+    TestIntervalJoin();
     TestJoin();
     TestLast();
+    TestMergeSorted();
     TestOrderBy();
+    TestOrderByExternal();
     TestPrepend();
     TestRange();
     TestRepeat();
@@ -1756,9 +2679,13 @@ void TestRvalue() {
     TestSkip();
     TestSkipLast();
     TestSkipWhile();
+    TestSumBy();
     TestTake();
     TestTakeLast();
     TestTakeWhile();
+    TestToDictionary();
+    TestToHashSet();
+    TestToLookup();
     TestUnion();
     TestWhere();
     TestZip();